@@ -10,6 +10,7 @@ void BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM)
 {
     int             i, j;
     double          t1, t2, t3, t4, r1;
+    double         *record;
     char            fn[100];
     char           *projectname;
     char           *token, *tempname;
@@ -513,18 +514,17 @@ void BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM)
             fgets (cmdstr, MAXSTRING, co2_file);
         }
         //printf ("Number of lines = %d", BGCM->Forcing[CO2_TS][0].length);
-        BGCM->Forcing[CO2_TS][0].TS = (double **)malloc ((BGCM->Forcing[CO2_TS][0].length) * sizeof (double *));
+        AllocTS (BGCM->Forcing[CO2_TS], 2);
         for (i = 0; i < BGCM->Forcing[CO2_TS][0].length; i++)
         {
-            BGCM->Forcing[CO2_TS][0].TS[i] = (double *)malloc (2 * sizeof (double));
-            fscanf (co2_file, "%d", &timeinfo->tm_year, &BGCM->Forcing[CO2_TS][0].TS[i][1]);
+            fscanf (co2_file, "%d", &timeinfo->tm_year, &BGCM->Forcing[CO2_TS][0].TS[i][0]);
             timeinfo->tm_year = timeinfo->tm_year - 1900;
             timeinfo->tm_mon = 0;
             timeinfo->tm_mday = 1;
             timeinfo->tm_hour = 0;
             timeinfo->tm_min = 0;
             timeinfo->tm_sec = 0;
-            BGCM->Forcing[CO2_TS][0].TS[i][0] = (double)rawtime;
+            BGCM->Forcing[CO2_TS][0].Time[i] = (double)rawtime;
         }
 
         fclose (co2_file);
@@ -548,24 +548,25 @@ void BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM)
             fgets (cmdstr, MAXSTRING, ndep_file);
         }
         //printf ("Number of lines = %d\n", BGCM->Forcing[NDEP_TS][0].length);
-        BGCM->Forcing[NDEP_TS][0].TS = (double **)malloc ((BGCM->Forcing[NDEP_TS][0].length) * sizeof (double *));
+        AllocTS (BGCM->Forcing[NDEP_TS], 2);
         for (i = 0; i < BGCM->Forcing[NDEP_TS][0].length; i++)
         {
-            BGCM->Forcing[NDEP_TS][0].TS[i] = (double *)malloc (2 * sizeof (double));
-            fscanf (ndep_file, "%d", &timeinfo->tm_year, &BGCM->Forcing[NDEP_TS][0].TS[i][1]);
+            fscanf (ndep_file, "%d", &timeinfo->tm_year, &BGCM->Forcing[NDEP_TS][0].TS[i][0]);
             timeinfo->tm_year = timeinfo->tm_year - 1900;
             timeinfo->tm_mon = 0;
             timeinfo->tm_mday = 1;
             timeinfo->tm_hour = 0;
             timeinfo->tm_min = 0;
             timeinfo->tm_sec = 0;
-            BGCM->Forcing[NDEP_TS][0].TS[i][0] = (double)rawtime;
+            BGCM->Forcing[NDEP_TS][0].Time[i] = (double)rawtime;
         }
         fclose (ndep_file);
     }
     /* Read soil moisture and soil temperature "forcing" */
     if (ctrl->spinup == 1)
     {
+        record = (double *)malloc ((PIHM->NumEle + 1) * sizeof (double));
+
         /* Read soil moisture forcing */
         BGCM->Forcing[SWC_TS] = (TSD *) malloc (sizeof (TSD));
         sprintf (SWC_fn, "input/%s/%s.SWC", filename, filename);
@@ -578,17 +579,16 @@ void BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM)
         /* Check the length of forcing */
         fseek (SWC_file, 0L, SEEK_END);
         BGCM->Forcing[SWC_TS][0].length = (int)(ftell (SWC_file) / (PIHM->NumEle + 1) / 8); /* 8 is the size of double */
-        BGCM->Forcing[SWC_TS][0].TS = (double **)malloc (BGCM->Forcing[SWC_TS][0].length * sizeof (double *));
-        /* Read in forcing */
+        AllocTS (BGCM->Forcing[SWC_TS], PIHM->NumEle + 1);
+        /* Read in forcing. Each record is the time followed by one value
+         * per element */
         rewind (SWC_file);
         for (j = 0; j < BGCM->Forcing[SWC_TS][0].length; j++)
         {
-            BGCM->Forcing[SWC_TS][0].TS[j] = (double *)malloc ((PIHM->NumEle + 1) * sizeof (double));
-            fread (&BGCM->Forcing[SWC_TS][0].TS[j][0], sizeof (double), 1, SWC_file);
+            fread (record, sizeof (double), PIHM->NumEle + 1, SWC_file);
+            BGCM->Forcing[SWC_TS][0].Time[j] = record[0];
             for (i = 0; i < PIHM->NumEle; i++)
-            {
-                fread (&BGCM->Forcing[SWC_TS][0].TS[j][1 + i], sizeof (double), 1, SWC_file);
-            }
+                BGCM->Forcing[SWC_TS][0].TS[j][i] = record[i + 1];
         }
         fclose (SWC_file);
 
@@ -604,19 +604,20 @@ void BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM)
         /* Check the length of forcing */
         fseek (STC_file, 0L, SEEK_END);
         BGCM->Forcing[STC_TS][0].length = (int)(ftell (STC_file) / (PIHM->NumEle + 1) / 8); /* 8 is the size of double */
-        BGCM->Forcing[STC_TS][0].TS = (double **)malloc (BGCM->Forcing[STC_TS][0].length * sizeof (double *));
-        /* Read in forcing */
+        AllocTS (BGCM->Forcing[STC_TS], PIHM->NumEle + 1);
+        /* Read in forcing. Each record is the time followed by one value
+         * per element */
         rewind (STC_file);
         for (j = 0; j < BGCM->Forcing[STC_TS][0].length; j++)
         {
-            BGCM->Forcing[STC_TS][0].TS[j] = (double *)malloc ((PIHM->NumEle + 1) * sizeof (double));
-            fread (&BGCM->Forcing[STC_TS][0].TS[j][0], sizeof (double), 1, STC_file);
+            fread (record, sizeof (double), PIHM->NumEle + 1, STC_file);
+            BGCM->Forcing[STC_TS][0].Time[j] = record[0];
             for (i = 0; i < PIHM->NumEle; i++)
-            {
-                fread (&BGCM->Forcing[STC_TS][0].TS[j][1 + i], sizeof (double), 1, STC_file);
-            }
+                BGCM->Forcing[STC_TS][0].TS[j][i] = record[i + 1];
         }
         fclose (STC_file);
+
+        free (record);
     }
 
     free (projectname);
@@ -662,11 +663,31 @@ void BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM)
     }
 }
 
+/*
+ * Memory held by the BGC grid and forcing. The spin-up met arrays are
+ * reported by metarr_init when they are allocated 
+ */
+void BGC_MemReport (Model_Data PIHM, bgc_struct BGCM)
+{
+    size_t          forc;
+
+    forc = 0;
+    if (BGCM->co2.varco2 == 1)
+        forc += SizeTS (BGCM->Forcing[CO2_TS]);
+    if (BGCM->ndepctrl.varndep == 1)
+        forc += SizeTS (BGCM->Forcing[NDEP_TS]);
+    if (BGCM->ctrl.spinup == 1)
+        forc += SizeTS (BGCM->Forcing[SWC_TS]) + SizeTS (BGCM->Forcing[STC_TS]);
+
+    PrintMem ("BGC grid", PIHM->NumEle * sizeof (bgc_grid));
+    PrintMem ("BGC forcing", forc);
+}
+
 void BGC_init (char *filename, Model_Data PIHM, LSM_STRUCT LSM, bgc_struct BGCM)
 {
     char            fn[100];
     FILE           *init_file;
-    int             i;
+    int             i, j;
     int             metyr;
 
     printf ("BGC: Initializing BGC structures\n");
@@ -695,8 +716,10 @@ void BGC_init (char *filename, Model_Data PIHM, LSM_STRUCT LSM, bgc_struct BGCM)
             exit (1);
         }
 
-        for (i = 0; i < PIHM->NumEle; i++)
+        for (j = 0; j < PIHM->NumEle; j++)
         {
+            /* Elements are stored in the order of the .mesh file */
+            i = PIHM->EleLoc[j];
             fread (&(BGCM->grid[i].restart_input), sizeof (restart_data_struct), 1, init_file);
             restart_input (&BGCM->grid[i].ws, &BGCM->grid[i].cs, &BGCM->grid[i].ns, &BGCM->grid[i].epv, &BGCM->grid[i].restart_input);
         }
@@ -3,6 +3,7 @@
 
 void            BGC_read (char *filename, bgc_struct BGCM, Model_Data PIHM);
 void            BGC_init (char *filename, Model_Data PIHM, LSM_STRUCT LSM, bgc_struct BGCM);
+void            BGC_MemReport (Model_Data PIHM, bgc_struct BGCM);
 void bgc_spinup (char *filename, bgc_struct BGCM, Model_Data PIHM, LSM_STRUCT LSM);
 void            daymet (const metarr_struct * metarr, metvar_struct * metv, int metday);
 //void            daymet (bgc_struct BGCM, Model_Data PIHM, LSM_STRUCT LSM, double t, int spinup);
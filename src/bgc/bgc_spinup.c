@@ -190,8 +190,10 @@ void bgc_spinup (char *filename, bgc_struct BGCM, Model_Data PIHM, LSM_STRUCT LS
     vegc_file = fopen("vegc.dat", "w");
     sprintf (restart_fn, "input/%s/%s.bgcinit", filename, filename);
     restart_file = fopen (restart_fn, "wb");
-    for (i = 0; i < PIHM->NumEle; i++)
+    for (j = 0; j < PIHM->NumEle; j++)
     {
+        /* Elements are written in the order of the .mesh file */
+        i = PIHM->EleLoc[j];
         restart_output (&BGCM->grid[i].ws, &BGCM->grid[i].cs, &BGCM->grid[i].ns, &BGCM->grid[i].epv, &BGCM->grid[i].restart_output);
 	fwrite(&(BGCM->grid[i].restart_output), sizeof(restart_data_struct), 1, restart_file);
         fprintf (soilc_file, "%lf\t", BGCM->grid[i].summary.soilc);
@@ -56,21 +56,21 @@ typedef struct
  * daily model loop */
 typedef struct
 {
-    double         *tmax;       /* (deg C) daily maximum air temperature */
-    double         *tmin;       /* (deg C) daily minimum air temperature */
-    double         *prcp;       /* (cm)    precipitation */
-    double         *vpd;        /* (Pa)    vapor pressure deficit */
-    double         *swavgfd;    /* (W/m2)  daylight avg shortwave flux density */
-    double         *par;        /* (W/m2)  photosynthetically active radiation */
-    double         *dayl;       /* (s)     daylength */
-    double         *prev_dayl;
-    double         *tavg;       /* (deg C) daily average temperature */
-    double         *tday;
-    double         *tnight;
-    double         *tsoil;
-    double         *swc;
-    double         *pa;
-    double         *tavg_ra;    /* (deg C) 11-day running avg of daily avg temp */
+    storetype      *tmax;       /* (deg C) daily maximum air temperature */
+    storetype      *tmin;       /* (deg C) daily minimum air temperature */
+    storetype      *prcp;       /* (cm)    precipitation */
+    storetype      *vpd;        /* (Pa)    vapor pressure deficit */
+    storetype      *swavgfd;    /* (W/m2)  daylight avg shortwave flux density */
+    storetype      *par;        /* (W/m2)  photosynthetically active radiation */
+    storetype      *dayl;       /* (s)     daylength */
+    storetype      *prev_dayl;
+    storetype      *tavg;       /* (deg C) daily average temperature */
+    storetype      *tday;
+    storetype      *tnight;
+    storetype      *tsoil;
+    storetype      *swc;
+    storetype      *pa;
+    storetype      *tavg_ra;    /* (deg C) 11-day running avg of daily avg temp */
 } metarr_struct;
 
 /* daily values that are passed to daily model subroutines */
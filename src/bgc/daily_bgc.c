@@ -25,7 +25,7 @@ void daily_bgc (bgc_struct BGCM, bgc_grid * grid, const double t, const double n
     phenology_struct *phen;
     summary_struct *summary;
     struct tm      *timestamp;
-    time_t         *rawtime;
+    time_t          rawtime;
 
     /* miscelaneous variables for program control in main */
     int             simyr, yday, metyr, metday;
@@ -57,9 +57,8 @@ void daily_bgc (bgc_struct BGCM, bgc_grid * grid, const double t, const double n
     psn_shade = &grid->psn_shade;
     summary = &grid->summary;
 
-    rawtime = (time_t *) malloc (sizeof (time_t));
-    *rawtime = (int)t;
-    timestamp = gmtime (rawtime);
+    rawtime = (int)t;
+    timestamp = gmtime (&rawtime);
 
 
     /* Get co2 and ndep */
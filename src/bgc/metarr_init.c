@@ -36,21 +36,22 @@ void metarr_init (bgc_struct BGCM, Model_Data PIHM, LSM_STRUCT LSM, double start
 
     for (i = 0; i < PIHM->NumEle; i++)
     {
-        BGCM->grid[i].metarr.tmax = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.tmin = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.prcp = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.vpd = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.swavgfd = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.par = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.dayl = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.prev_dayl = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.tavg = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.tday = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.tnight = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.tsoil = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.swc = (double *)malloc (length * sizeof (double));
-        BGCM->grid[i].metarr.pa = (double *)malloc (length * sizeof (double));
+        BGCM->grid[i].metarr.tmax = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.tmin = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.prcp = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.vpd = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.swavgfd = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.par = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.dayl = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.prev_dayl = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.tavg = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.tday = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.tnight = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.tsoil = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.swc = (storetype *) malloc (length * sizeof (storetype));
+        BGCM->grid[i].metarr.pa = (storetype *) malloc (length * sizeof (storetype));
     }
+    PrintMem ("BGC met arrays", (size_t)PIHM->NumEle * length * 14 * sizeof (storetype));
 
     for (j = 0; j < length; j++)
     {
@@ -198,8 +199,9 @@ void metarr_init (bgc_struct BGCM, Model_Data PIHM, LSM_STRUCT LSM, double start
             metarr->par[j] = metarr->swavgfd[j] * RAD2PAR;
 
 
-            metarr->tsoil[j] = stc[i] - 273.15;
-            metarr->swc[j] = swc[i];
+            /* Forcing columns follow the order of the .mesh file */
+            metarr->tsoil[j] = stc[PIHM->Ele[i].index - 1] - 273.15;
+            metarr->swc[j] = swc[PIHM->Ele[i].index - 1];
             //if (i==0) printf ("%lf %lf\t", metarr->tsoil[j], metarr->swc[j]);
             //metarr->tsoil[j] = Interpolation (&BGCM->Forcing[STC_TS][i], t) - 273.15;
             //metarr->swc[j] = Interpolation (&BGCM->Forcing[SWC_TS][i], t);
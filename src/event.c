@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * File		: event.c
+ * Function	: Priority queue of recurring events that drive the main loop
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "pihm.h"
+
+/*
+ * Ordering of the heap: earlier time first, then event type, then index
+ */
+static int EventBefore (const Event * a, const Event * b)
+{
+    if (a->t != b->t)
+        return (a->t < b->t);
+    if (a->type != b->type)
+        return (a->type < b->type);
+    return (a->index < b->index);
+}
+
+static void PushEvent (Event_Queue * Q, const Event * E)
+{
+    int             i, parent;
+
+    if (Q->num == Q->size)
+    {
+        Q->size = Q->size > 0 ? 2 * Q->size : 16;
+        Q->heap = (Event *) realloc (Q->heap, Q->size * sizeof (Event));
+    }
+
+    /* Sift up */
+    i = Q->num++;
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+        if (!EventBefore (E, &Q->heap[parent]))
+            break;
+        Q->heap[i] = Q->heap[parent];
+        i = parent;
+    }
+    Q->heap[i] = *E;
+}
+
+void InitEvents (Event_Queue * Q)
+{
+    Q->num = 0;
+    Q->size = 0;
+    Q->heap = NULL;
+}
+
+/*
+ * Schedule an event at time t. Events with a positive interval recur, and
+ * the interval is multiplied by factor after each occurrence
+ */
+void AddEvent (Event_Queue * Q, int type, int index, double t, double interval, double factor)
+{
+    Event           E;
+
+    E.t = t;
+    E.interval = interval;
+    E.factor = factor;
+    E.type = type;
+    E.index = index;
+    PushEvent (Q, &E);
+}
+
+double NextEventTime (const Event_Queue * Q)
+{
+    return (Q->num > 0 ? Q->heap[0].t : HUGE_VAL);
+}
+
+/*
+ * Remove the earliest event and schedule its next occurrence
+ */
+void PopEvent (Event_Queue * Q, Event * E)
+{
+    Event           last, next;
+    int             i, child;
+
+    *E = Q->heap[0];
+
+    /* Sift the last event down from the root */
+    last = Q->heap[--Q->num];
+    i = 0;
+    while ((child = 2 * i + 1) < Q->num)
+    {
+        if (child + 1 < Q->num && EventBefore (&Q->heap[child + 1], &Q->heap[child]))
+            child++;
+        if (!EventBefore (&Q->heap[child], &last))
+            break;
+        Q->heap[i] = Q->heap[child];
+        i = child;
+    }
+    if (Q->num > 0)
+        Q->heap[i] = last;
+
+    if (E->interval > 0.)
+    {
+        next = *E;
+        next.t = E->t + E->interval;
+        next.interval = E->interval * E->factor;
+        PushEvent (Q, &next);
+    }
+}
+
+void FreeEvents (Event_Queue * Q)
+{
+    free (Q->heap);
+    Q->heap = NULL;
+    Q->num = 0;
+    Q->size = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef EVENT_HEADER
+#define EVENT_HEADER
+
+/*
+ * Event types. Events due at the same time are handled in this order
+ */
+enum event_type
+{
+    STEP_EVENT,                 /* end of a model step */
+    PRINT_EVENT,                /* write a PIHM output stream */
+    LSM_PRINT_EVENT,            /* write an LSM output stream */
+    ET_EVENT                    /* land surface (or ET) step */
+};
+
+typedef struct Event_type
+{
+    double          t;          /* time the event is due */
+    double          interval;   /* time to the next occurrence (0: once) */
+    double          factor;     /* growth of the interval after each
+                                 * occurrence */
+    int             type;
+    int             index;      /* output stream of print events */
+} Event;
+
+typedef struct Event_Queue_type
+{
+    int             num;        /* number of pending events */
+    int             size;       /* capacity of heap */
+    Event          *heap;       /* binary min-heap ordered by time, type
+                                 * and index */
+} Event_Queue;
+
+void InitEvents (Event_Queue * Q);
+void AddEvent (Event_Queue * Q, int type, int index, double t, double interval, double factor);
+double NextEventTime (const Event_Queue * Q);
+void PopEvent (Event_Queue * Q, Event * E);
+void FreeEvents (Event_Queue * Q);
+
+#endif
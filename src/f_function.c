@@ -2,53 +2,116 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#ifdef _FAST_HYDRAULICS_
+#include <stdint.h>
+#endif
 #include "pihm.h"
 
-realtype returnVal (realtype rArea, realtype rPerem, realtype eqWid, realtype ap_Bool)
+#ifdef _FAST_HYDRAULICS_
+/*
+ * Fast x^(2/3) for Manning's equation. The mantissa m in [1, 2) is taken
+ * apart from the exponent, m^(-1/3) is approximated by a cubic (relative
+ * error 3.0e-4) refined by two Newton steps, and the exponent is applied
+ * by constructing the power of two directly. Maximum relative error
+ * against pow () is below 1e-13 for all positive normal x. Zero, negative,
+ * subnormal and non-finite arguments fall back to pow (). Square roots are
+ * left to sqrt (), which is a single correctly rounded instruction 
+ */
+static realtype powTwoThirds (realtype x)
 {
-    if (ap_Bool == 1)
-        return rArea;
-    else if (ap_Bool == 2)
-        return rPerem;
-    else
-        return eqWid;
+    static const realtype scale[3] = { 1.0, 1.5874010519681994, 2.5198420997897464 };
+    uint64_t        bits;
+    realtype        m, y, p;
+    int             e, q, r;
+
+    memcpy (&bits, &x, sizeof (bits));
+    e = (int)(bits >> 52) - 1023;
+    if (e == -1023 || e == 1024 || (bits >> 63))
+        return pow (x, 2.0 / 3.0);
+    bits = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+    memcpy (&m, &bits, sizeof (m));
+    /* e = 3 * q + r, with r in {0, 1, 2} */
+    q = (e + 1023) / 3 - 341;
+    r = e - 3 * q;
+    y = 1.5377602662728744 + m * (-0.8012745696637481 + m * (0.3118472681731671 - 0.048633053342840536 * m));
+    y = y * (4.0 - m * y * y * y) / 3.0;
+    y = y * (4.0 - m * y * y * y) / 3.0;
+    bits = (uint64_t) (1023 + 2 * q) << 52;
+    memcpy (&p, &bits, sizeof (p));
+    return m * y * scale[r] * p;
+}
+#else
+#define powTwoThirds(x)	pow ((x), 2.0 / 3.0)
+#endif
+
+/*
+ * Cross section area, wetted perimeter and top width of each river shape,
+ * evaluated separately so that only the requested one is computed 
+ */
+realtype CS_Area (int rivOrder, realtype rivDepth, realtype rivCoeff)
+{
+    switch (rivOrder)
+    {
+        case 1:
+            return rivDepth * rivCoeff;
+        case 2:
+            return pow (rivDepth, 2) / rivCoeff;
+        case 3:
+            return 4 * pow (rivDepth, 1.5) / (3 * pow (rivCoeff, 0.5));
+        case 4:
+            return 3 * pow (rivDepth, 4.0 / 3.0) / (2 * pow (rivCoeff, 1.0 / 3.0));
+        default:
+            printf ("\n Relevant Values entered are wrong");
+            printf ("\n Depth: %lf\tCoeff: %lf\tOrder: %d\t", rivDepth, rivCoeff, rivOrder);
+            return 0;
+    }
 }
 
-realtype CS_AreaOrPerem (int rivOrder, realtype rivDepth, realtype rivCoeff, realtype a_pBool)
+realtype CS_Perem (int rivOrder, realtype rivDepth, realtype rivCoeff)
 {
-    realtype        rivArea, rivPerem, eq_Wid;
     switch (rivOrder)
     {
         case 1:
-            rivArea = rivDepth * rivCoeff;
-            rivPerem = 2.0 * rivDepth + rivCoeff;
-            eq_Wid = rivCoeff;
-            return returnVal (rivArea, rivPerem, eq_Wid, a_pBool);
+            return 2.0 * rivDepth + rivCoeff;
         case 2:
-            rivArea = pow (rivDepth, 2) / rivCoeff;
-            rivPerem = 2.0 * rivDepth * pow (1 + pow (rivCoeff, 2), 0.5) / rivCoeff;
-            eq_Wid = 2.0 * pow (rivDepth + EPS, 1 / (rivOrder - 1)) / pow (rivCoeff, 1 / (rivOrder - 1));
-            return returnVal (rivArea, rivPerem, eq_Wid, a_pBool);
+            return 2.0 * rivDepth * pow (1 + pow (rivCoeff, 2), 0.5) / rivCoeff;
         case 3:
-            rivArea = 4 * pow (rivDepth, 1.5) / (3 * pow (rivCoeff, 0.5));
-            rivPerem = (pow (rivDepth * (1 + 4 * rivCoeff * rivDepth) / rivCoeff, 0.5)) + (log (2 * pow (rivCoeff * rivDepth, 0.5) + pow (1 + 4 * rivCoeff * rivDepth, 0.5)) / (2 * rivCoeff));
-            eq_Wid = 2.0 * pow (rivDepth + EPS, 1 / (rivOrder - 1)) / pow (rivCoeff, 1 / (rivOrder - 1));
-            return returnVal (rivArea, rivPerem, eq_Wid, a_pBool);
+            return (pow (rivDepth * (1 + 4 * rivCoeff * rivDepth) / rivCoeff, 0.5)) + (log (2 * pow (rivCoeff * rivDepth, 0.5) + pow (1 + 4 * rivCoeff * rivDepth, 0.5)) / (2 * rivCoeff));
         case 4:
-            rivArea = 3 * pow (rivDepth, 4.0 / 3.0) / (2 * pow (rivCoeff, 1.0 / 3.0));
-            rivPerem = 2 * ((pow (rivDepth * (1 + 9 * pow (rivCoeff, 2.0 / 3.0) * rivDepth), 0.5) / 3) + (log (3 * pow (rivCoeff, 1.0 / 3.0) * pow (rivDepth, 0.5) + pow (1 + 9 * pow (rivCoeff, 2.0 / 3.0) * rivDepth, 0.5)) / (9 * pow (rivCoeff, 1.0 / 3.0))));
-            eq_Wid = 2.0 * pow (rivDepth + EPS, 1 / (rivOrder - 1)) / pow (rivCoeff, 1 / (rivOrder - 1));
-            return returnVal (rivArea, rivPerem, eq_Wid, a_pBool);
+            return 2 * ((pow (rivDepth * (1 + 9 * pow (rivCoeff, 2.0 / 3.0) * rivDepth), 0.5) / 3) + (log (3 * pow (rivCoeff, 1.0 / 3.0) * pow (rivDepth, 0.5) + pow (1 + 9 * pow (rivCoeff, 2.0 / 3.0) * rivDepth, 0.5)) / (9 * pow (rivCoeff, 1.0 / 3.0))));
         default:
             printf ("\n Relevant Values entered are wrong");
-            printf ("\n Depth: %lf\tCoeff: %lf\tOrder: %d\t");
+            printf ("\n Depth: %lf\tCoeff: %lf\tOrder: %d\t", rivDepth, rivCoeff, rivOrder);
+            return 0;
+    }
+}
+
+/*
+ * Note: the width exponent 1 / (rivOrder - 1) has always been evaluated in
+ * integer arithmetic, so the width is linear in depth for order 2 and
+ * constant for orders 3 and 4 
+ */
+realtype CS_Width (int rivOrder, realtype rivDepth, realtype rivCoeff)
+{
+    switch (rivOrder)
+    {
+        case 1:
+            return rivCoeff;
+        case 2:
+            return 2.0 * (rivDepth + EPS) / rivCoeff;
+        case 3:
+        case 4:
+            return 2.0;
+        default:
+            printf ("\n Relevant Values entered are wrong");
+            printf ("\n Depth: %lf\tCoeff: %lf\tOrder: %d\t", rivDepth, rivCoeff, rivOrder);
             return 0;
     }
 }
 
 void OverlandFlow (realtype ** flux, int loci, int locj, realtype avg_y, realtype grad_y, realtype avg_sf, realtype crossA, realtype avg_rough)
 {
-    flux[loci][locj] = crossA * pow (avg_y, 2.0 / 3.0) * grad_y / (sqrt (fabs (avg_sf)) * avg_rough);
+    flux[loci][locj] = crossA * powTwoThirds (avg_y) * grad_y / (sqrt (fabs (avg_sf)) * avg_rough);
     //  flux[loci][locj] = (grad_y>0?1:-1)*crossA*pow(avg_y, 2.0/3.0)*sqrt(fabs(grad_y))/(avg_rough);
 }
 
@@ -178,3 +241,201 @@ realtype effKH (int mp, realtype tmpY, realtype aqDepth, realtype MacD, realtype
         return ksatH;
 }
 
+
+/*
+ * van Genuchten relative conductivity (Mualem) and suction head (scaled by
+ * Alpha) as functions of effective saturation
+ */
+static realtype vgKrExact (realtype satn, realtype beta)
+{
+    return pow (satn, 0.5) * pow (-1 + pow (1 - pow (satn, beta / (beta - 1)), (beta - 1) / beta), 2);
+}
+
+static realtype vgHeadExact (realtype satn, realtype beta)
+{
+    return pow (pow (1 / satn, beta / (beta - 1)) - 1, 1 / beta);
+}
+
+static int tblOutOfBound (realtype approx, realtype exact, realtype tol)
+{
+    return fabs (approx - exact) > tol * fabs (exact);
+}
+
+/*
+ * Build the table of one soil type on [satnMin, 1]. The grid is refined
+ * until no more than 1/64 of the intervals fail the error bound, which is
+ * checked at the quarter points of each interval. The failing intervals
+ * are the ones close to saturation, where both functions have unbounded
+ * slopes.
+ */
+void InitVGTable (vg_table * tbl, realtype beta, realtype satnMin, realtype tol)
+{
+    int             k, l, nfail;
+    realtype        satn, frac;
+
+    tbl->n = 0;
+    tbl->kr = NULL;
+    tbl->head = NULL;
+    tbl->exact = NULL;
+    if (tol <= 0)
+        return;
+
+    for (tbl->n = 64; tbl->n <= 65536; tbl->n *= 2)
+    {
+        tbl->satnMin = satnMin;
+        tbl->dsatn = (1 - satnMin) / tbl->n;
+        tbl->kr = (realtype *) realloc (tbl->kr, (tbl->n + 1) * sizeof (realtype));
+        tbl->head = (realtype *) realloc (tbl->head, (tbl->n + 1) * sizeof (realtype));
+        tbl->exact = (char *)realloc (tbl->exact, tbl->n * sizeof (char));
+        for (k = 0; k <= tbl->n; k++)
+        {
+            satn = (k < tbl->n) ? satnMin + k * tbl->dsatn : 1.0;
+            tbl->kr[k] = vgKrExact (satn, beta);
+            tbl->head[k] = vgHeadExact (satn, beta);
+        }
+        nfail = 0;
+        for (k = 0; k < tbl->n; k++)
+        {
+            tbl->exact[k] = 0;
+            for (l = 1; l < 4; l++)
+            {
+                frac = 0.25 * l;
+                satn = satnMin + (k + frac) * tbl->dsatn;
+                if (tblOutOfBound (tbl->kr[k] + frac * (tbl->kr[k + 1] - tbl->kr[k]), vgKrExact (satn, beta), tol) || tblOutOfBound (tbl->head[k] + frac * (tbl->head[k + 1] - tbl->head[k]), vgHeadExact (satn, beta), tol))
+                    tbl->exact[k] = 1;
+            }
+            nfail += tbl->exact[k];
+        }
+        if (64 * nfail <= tbl->n || tbl->n == 65536)
+            break;
+    }
+}
+
+void FreeVGTable (vg_table * tbl)
+{
+    free (tbl->kr);
+    free (tbl->head);
+    free (tbl->exact);
+}
+
+realtype vgKr (const vg_table * tbl, realtype satn, realtype beta)
+{
+    realtype        x;
+    int             k;
+
+    if (tbl->n > 0 && satn >= tbl->satnMin)
+    {
+        x = (satn - tbl->satnMin) / tbl->dsatn;
+        k = (int)x;
+        if (k >= tbl->n)
+            return tbl->kr[tbl->n];
+        if (!tbl->exact[k])
+            return tbl->kr[k] + (x - k) * (tbl->kr[k + 1] - tbl->kr[k]);
+    }
+    return vgKrExact (satn, beta);
+}
+
+realtype vgHead (const vg_table * tbl, realtype satn, realtype beta)
+{
+    realtype        x;
+    int             k;
+
+    if (tbl->n > 0 && satn >= tbl->satnMin)
+    {
+        x = (satn - tbl->satnMin) / tbl->dsatn;
+        k = (int)x;
+        if (k >= tbl->n)
+            return tbl->head[tbl->n];
+        if (!tbl->exact[k])
+            return tbl->head[k] + (x - k) * (tbl->head[k + 1] - tbl->head[k]);
+    }
+    return vgHeadExact (satn, beta);
+}
+
+/*
+ * Build the table of one river shape on [0, yMax], refined the same way as
+ * the van Genuchten tables. Intervals close to zero depth, where area and
+ * perimeter are not smooth, are evaluated exactly. Rectangular channels
+ * are linear in depth and never tabulated.
+ */
+void InitRivTable (riv_table * tbl, int order, realtype coeff, realtype yMax, realtype tol)
+{
+    int             k, l, nfail;
+    realtype        y, frac;
+
+    tbl->n = 0;
+    tbl->order = order;
+    tbl->coeff = coeff;
+    tbl->area = NULL;
+    tbl->perem = NULL;
+    tbl->exact = NULL;
+    if (tol <= 0 || order == 1 || yMax <= 0)
+        return;
+
+    for (tbl->n = 64; tbl->n <= 65536; tbl->n *= 2)
+    {
+        tbl->dy = yMax / tbl->n;
+        tbl->area = (realtype *) realloc (tbl->area, (tbl->n + 1) * sizeof (realtype));
+        tbl->perem = (realtype *) realloc (tbl->perem, (tbl->n + 1) * sizeof (realtype));
+        tbl->exact = (char *)realloc (tbl->exact, tbl->n * sizeof (char));
+        for (k = 0; k <= tbl->n; k++)
+        {
+            y = (k < tbl->n) ? k * tbl->dy : yMax;
+            tbl->area[k] = CS_Area (order, y, coeff);
+            tbl->perem[k] = CS_Perem (order, y, coeff);
+        }
+        nfail = 0;
+        for (k = 0; k < tbl->n; k++)
+        {
+            tbl->exact[k] = 0;
+            for (l = 1; l < 4; l++)
+            {
+                frac = 0.25 * l;
+                y = (k + frac) * tbl->dy;
+                if (tblOutOfBound (tbl->area[k] + frac * (tbl->area[k + 1] - tbl->area[k]), CS_Area (order, y, coeff), tol) || tblOutOfBound (tbl->perem[k] + frac * (tbl->perem[k + 1] - tbl->perem[k]), CS_Perem (order, y, coeff), tol))
+                    tbl->exact[k] = 1;
+            }
+            nfail += tbl->exact[k];
+        }
+        if (64 * nfail <= tbl->n || tbl->n == 65536)
+            break;
+    }
+    tbl->yMax = yMax;
+}
+
+void FreeRivTable (riv_table * tbl)
+{
+    free (tbl->area);
+    free (tbl->perem);
+    free (tbl->exact);
+}
+
+realtype rivArea (const riv_table * tbl, realtype y)
+{
+    realtype        x;
+    int             k;
+
+    if (tbl->n > 0 && y >= 0 && y < tbl->yMax)
+    {
+        x = y / tbl->dy;
+        k = (int)x;
+        if (k < tbl->n && !tbl->exact[k])
+            return tbl->area[k] + (x - k) * (tbl->area[k + 1] - tbl->area[k]);
+    }
+    return CS_Area (tbl->order, y, tbl->coeff);
+}
+
+realtype rivPerem (const riv_table * tbl, realtype y)
+{
+    realtype        x;
+    int             k;
+
+    if (tbl->n > 0 && y >= 0 && y < tbl->yMax)
+    {
+        x = y / tbl->dy;
+        k = (int)x;
+        if (k < tbl->n && !tbl->exact[k])
+            return tbl->perem[k] + (x - k) * (tbl->perem[k + 1] - tbl->perem[k]);
+    }
+    return CS_Perem (tbl->order, y, tbl->coeff);
+}
@@ -0,0 +1,670 @@
+/*****************************************************************************
+ * File		: f_kernel.h
+ * Function	: Template of the model kernel (see f.c). Included once per
+ *		  RHS variant, with the following macros defined:
+ *		  RHS_FUNC	name of the RHS function
+ *		  EDGE_FUNC	name of its element-element edge flux function
+ *		  SURF_MODE	surface flow mode (1: kinematic, 2: diffusion wave)
+ *		  RIV_MODE	river flow mode (1: kinematic, 2: diffusion wave)
+ *		  Modes may be constants, or MD->SurfMode and MD->RivMode for
+ *		  the generic variant. All four macros are undefined at the end
+ ****************************************************************************/
+
+/*
+ * Surface and subsurface fluxes across edge j of element i, shared with
+ * another element 
+ */
+static void EDGE_FUNC (Model_Data MD, int i, int j)
+{
+    int             inabr;
+    realtype        Avg_Y_Surf, Dif_Y_Surf, Grad_Y_Surf, Avg_Sf, Distance, CrossA, Avg_Rough;
+    realtype        Avg_Y_Sub, Dif_Y_Sub, Avg_Ksat, Grad_Y_Sub, effK, effKnabr;
+
+    /*
+     * Subsurface Lateral Flux Calculation between Triangular elements Follows 
+     */
+    Dif_Y_Sub = (MD->DummyY[i + 2 * MD->NumEle] + MD->EleZmin[i]) - (MD->DummyY[MD->EleNabr[3 * i + j] - 1 + 2 * MD->NumEle] + MD->EleZmin[MD->EleNabr[3 * i + j] - 1]);
+    //              Avg_Y_Sub=avgY(MD->Ele[i].zmin,MD->Ele[MD->Ele[i].nabr[j]-1].zmin,MD->DummyY[i+2*MD->NumEle],MD->DummyY[MD->Ele[i].nabr[j]-1 + 2*MD->NumEle]);
+    Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 2 * MD->NumEle], MD->DummyY[MD->EleNabr[3 * i + j] - 1 + 2 * MD->NumEle]);
+    Distance = MD->Ele[i].dist[j];
+    Grad_Y_Sub = Dif_Y_Sub / Distance;
+    /*
+     * take care of macropore effect 
+     */
+    inabr = MD->EleNabr[3 * i + j] - 1;
+    effK = MD->EleEffKH[i];
+    effKnabr = MD->EleEffKH[inabr];
+    /*
+     * It should be weighted average. However, there is an ambiguity about distance used 
+     */
+    Avg_Ksat = 0.5 * (effK + effKnabr);
+    /*
+     * groundwater flow modeled by Darcy's law 
+     */
+    MD->FluxSub[i][j] = Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub * MD->Ele[i].edge[j];
+
+    /*
+     * Surface Lateral Flux Calculation between Triangular elements Follows    
+     */
+    Dif_Y_Surf = (SURF_MODE == 1) ? (MD->EleZmax[i] - MD->EleZmax[MD->EleNabr[3 * i + j] - 1]) : ((MD->DummyY[i] + MD->EleZmax[i]) - (MD->DummyY[MD->EleNabr[3 * i + j] - 1] + MD->EleZmax[MD->EleNabr[3 * i + j] - 1]));
+    //              Avg_Y_Surf=avgY(MD->Ele[i].zmax,MD->Ele[MD->Ele[i].nabr[j] - 1].zmax,MD->DummyY[i],MD->DummyY[MD->Ele[i].nabr[j]-1]);
+    Avg_Y_Surf = avgY (Dif_Y_Surf, MD->DummyY[i], MD->DummyY[MD->EleNabr[3 * i + j] - 1]);
+    Grad_Y_Surf = Dif_Y_Surf / Distance;
+    Avg_Sf = 0.5 * (MD->EleSlope[i] + MD->EleSlope[MD->EleNabr[3 * i + j] - 1]); //?? Xuan Weighting needed
+    //              Avg_Sf=sqrt(pow(MD->Ele[i].dhBYdx,2)+pow(MD->Ele[i].dhBYdy,2));
+    Avg_Sf = (SURF_MODE == 1) ? (Grad_Y_Surf > 0 ? Grad_Y_Surf : EPS / 1.0e6) : (Avg_Sf > EPS / 1.0e6 ? Avg_Sf : EPS / 1.0e6);
+    /*
+     * Weighting needed 
+     */
+    Avg_Rough = 0.5 * (MD->Ele[i].Rough + MD->Ele[MD->EleNabr[3 * i + j] - 1].Rough);
+    CrossA = Avg_Y_Surf * MD->Ele[i].edge[j];
+    OverlandFlow (MD->FluxSurf, i, j, Avg_Y_Surf, Grad_Y_Surf, Avg_Sf, CrossA, Avg_Rough);
+}
+
+int RHS_FUNC (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *DS)
+{
+    int             i, j, k, inabr;
+    realtype        Avg_Sf, Distance;
+    realtype        TotalY_Riv, TotalY_Riv_down, CrossA, CrossAdown, AvgCrossA, Perem, Perem_down, Avg_Rough, Avg_Perem, Avg_Y_Riv, Dif_Y_Riv, Grad_Y_Riv, Wid, Wid_down, Avg_Wid;
+    realtype        Avg_Y_Sub, Dif_Y_Sub, Avg_Ksat, Grad_Y_Sub, AquiferDepth, Deficit, elemSatn, satKfunc, effK, effKnabr, TotalY_Ele, TotalY_Ele_down;
+    realtype       *Y, *DY;
+    realtype        dt;     /* YS */
+    Model_Data      MD;
+
+    Y = NV_DATA_S (CV_Y);
+    MD = (Model_Data) DS;
+    DY = NV_DATA_S (CV_Ydot);
+
+    dt = MD->dt;
+
+    /*
+     * All phases below run in one parallel region, so the team of threads
+     * is forked once per call. Each phase is a work-sharing loop, and its
+     * implicit barrier keeps it from starting before the previous one ends 
+     */
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        /*
+         * Initialization of temporary state variables 
+         */
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (i = 0; i < 3 * MD->NumEle + 2 * MD->NumRiv; i++)
+        {
+            MD->DummyY[i] = (Y[i] >= 0) ? Y[i] : 0;
+            DY[i] = 0;
+        }
+        /*
+         * Surface slopes need the heads of neighboring elements and rivers, so
+         * they are evaluated only after all temporary states are set. Slope
+         * magnitude and effective horizontal conductivity are shared by all
+         * edges of an element, and are evaluated once per call here 
+         */
+#ifdef _OPENMP
+#pragma omp for private (j)
+#endif
+        for (i = 0; i < MD->NumEle; i++)
+        {
+            if (SURF_MODE == 2)
+            {
+                for (j = 0; j < 3; j++)
+                    MD->Ele[i].surfH[j] = (MD->EleNabr[3 * i + j] > 0) ? ((MD->Ele[i].BC[j] > -4) ? (MD->EleZmax[MD->EleNabr[3 * i + j] - 1] + MD->DummyY[MD->EleNabr[3 * i + j] - 1]) : ((MD->DummyY[-(MD->Ele[i].BC[j] / 4) - 1 + 3 * MD->NumEle] > MD->Riv[-(MD->Ele[i].BC[j] / 4) - 1].depth) ? MD->Riv[-(MD->Ele[i].BC[j] / 4) - 1].zmin + MD->DummyY[-(MD->Ele[i].BC[j] / 4) - 1 + 3 * MD->NumEle] : MD->Riv[-(MD->Ele[i].BC[j] / 4) - 1].zmax)) : ((MD->Ele[i].BC[j] != 1) ? (MD->EleZmax[i] + MD->DummyY[i]) : Interpolation (&MD-> TSD_EleBC[(MD->Ele[i].BC[j]) - 1], t));
+                MD->Ele[i].dhBYdx = -1 * (MD->Ele[i].surfY[2] * (MD->Ele[i].surfH[1] - MD->Ele[i].surfH[0]) + MD->Ele[i].surfY[1] * (MD->Ele[i].surfH[0] - MD->Ele[i].surfH[2]) + MD->Ele[i].surfY[0] * (MD->Ele[i].surfH[2] - MD->Ele[i].surfH[1])) / (MD->Ele[i].surfX[2] * (MD->Ele[i].surfY[1] - MD->Ele[i].surfY[0]) + MD->Ele[i].surfX[1] * (MD->Ele[i].surfY[0] - MD->Ele[i].surfY[2]) + MD->Ele[i].surfX[0] * (MD->Ele[i].surfY[2] - MD->Ele[i].surfY[1]));
+                MD->Ele[i].dhBYdy = -1 * (MD->Ele[i].surfX[2] * (MD->Ele[i].surfH[1] - MD->Ele[i].surfH[0]) + MD->Ele[i].surfX[1] * (MD->Ele[i].surfH[0] - MD->Ele[i].surfH[2]) + MD->Ele[i].surfX[0] * (MD->Ele[i].surfH[2] - MD->Ele[i].surfH[1])) / (MD->Ele[i].surfY[2] * (MD->Ele[i].surfX[1] - MD->Ele[i].surfX[0]) + MD->Ele[i].surfY[1] * (MD->Ele[i].surfX[0] - MD->Ele[i].surfX[2]) + MD->Ele[i].surfY[0] * (MD->Ele[i].surfX[2] - MD->Ele[i].surfX[1]));
+            }
+            MD->EleSlope[i] = sqrt (pow (MD->Ele[i].dhBYdx, 2) + pow (MD->Ele[i].dhBYdy, 2));
+            MD->EleEffKH[i] = effKH (MD->Ele[i].Macropore, MD->DummyY[i + 2 * MD->NumEle], MD->EleZmax[i] - MD->EleZmin[i], MD->Ele[i].macD, MD->Ele[i].macKsatH, MD->Ele[i].vAreaF, MD->EleKsatH[i]);
+        }
+        /*
+         * Element beneath river takes the average conductivity of its bank
+         * elements. Cross section area and perimeter of each segment are also
+         * needed by its up stream segments 
+         */
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (i = 0; i < MD->NumRiv; i++)
+        {
+            MD->RivEffKH[i] = 0.5 * (MD->EleEffKH[MD->Riv[i].LeftEle - 1] + MD->EleEffKH[MD->Riv[i].RightEle - 1]);
+            MD->RivArea[i] = rivArea (&MD->RivTbl[MD->Riv[i].shape - 1], MD->DummyY[i + 3 * MD->NumEle]);
+            MD->RivPerem[i] = rivPerem (&MD->RivTbl[MD->Riv[i].shape - 1], MD->DummyY[i + 3 * MD->NumEle]);
+        }
+        /*
+         * Lateral Flux Calculation between Triangular elements Follows  
+         * Note: edges are classified in initialize (), and each list is handled
+         * by its own loop. Each edge only writes its own fluxes. macD is already
+         * limited by the aquifer depth in initialize () 
+         */
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (k = 0; k < MD->NumIntrEdge; k++)
+            EDGE_FUNC (MD, MD->IntrEdge[k] / 3, MD->IntrEdge[k] % 3);
+        /*
+         * Edges along a river are first treated as element-element edges, and
+         * the fluxes are replaced by bank fluxes once river fluxes are known 
+         */
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (k = 0; k < MD->NumRivEdge; k++)
+            EDGE_FUNC (MD, MD->RivEdge[k] / 3, MD->RivEdge[k] % 3);
+
+        /*
+         * Boundary condition Flux Calculations Follows 
+         * No flow (natural) boundary condition is default 
+         */
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (k = 0; k < MD->NumNoFlowEdge; k++)
+        {
+            MD->FluxSurf[MD->NoFlowEdge[k] / 3][MD->NoFlowEdge[k] % 3] = 0;
+            MD->FluxSub[MD->NoFlowEdge[k] / 3][MD->NoFlowEdge[k] % 3] = 0;
+        }
+        /*
+         * Note: ideally different boundary conditions need to be incorporated
+         * for surf and subsurf respectively. The formulation assumes only
+         * dirichlet TS right now 
+         */
+#ifdef _OPENMP
+#pragma omp for private (i, j, Avg_Y_Sub, Dif_Y_Sub, Avg_Ksat, Grad_Y_Sub, Distance, effK)
+#endif
+        for (k = 0; k < MD->NumDiriEdge; k++)
+        {
+            i = MD->DiriEdge[k] / 3;
+            j = MD->DiriEdge[k] % 3;
+            MD->FluxSurf[i][j] = 0;     /* Note the assumption here is no flow for surface */
+            Dif_Y_Sub = (MD->DummyY[i + 2 * MD->NumEle] + MD->EleZmin[i]) - Interpolation (&MD->TSD_EleBC[(MD->Ele[i].BC[j]) - 1], t);
+            Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 2 * MD->NumEle], (Interpolation (&MD->TSD_EleBC[(MD->Ele[i].BC[j]) - 1], t) - MD->EleZmin[i]));
+            /*
+             * Minimum Distance from circumcenter to the edge of the triangle on which BDD. condition is defined
+             */
+            Distance = MD->Ele[i].dist[j];
+            effK = MD->EleEffKH[i];
+            Avg_Ksat = effK;
+            Grad_Y_Sub = Dif_Y_Sub / Distance;
+            MD->FluxSub[i][j] = Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub * MD->Ele[i].edge[j];
+        }
+        /*
+         * Neumann BC (Note: MD->Ele[i].BC[j] value have to be = 2+(index of neumann boundary TS) 
+         */
+#ifdef _OPENMP
+#pragma omp for private (i, j)
+#endif
+        for (k = 0; k < MD->NumNeumEdge; k++)
+        {
+            i = MD->NeumEdge[k] / 3;
+            j = MD->NeumEdge[k] % 3;
+            MD->FluxSurf[i][j] = Interpolation (&MD->TSD_EleBC[(MD->Ele[i].BC[j]) - 1], t);
+            MD->FluxSub[i][j] = Interpolation (&MD->TSD_EleBC[(-MD->Ele[i].BC[j]) - 1], t);
+        }
+
+        /*
+         * Lateral Flux Calculation between River-River and River-Triangular elements Follows 
+         * Note: each segment only writes its own FluxRiv entries here; bank
+         * edges are read through the edge map set in initialize (). Bank
+         * fluxes of elements and inflows from upstream segments are applied in
+         * the loops that follow 
+         */
+#ifdef _OPENMP
+#pragma omp for private (Avg_Sf, Distance, TotalY_Riv, TotalY_Riv_down, CrossA, CrossAdown, AvgCrossA, Perem, Perem_down, Avg_Rough, Avg_Perem, Avg_Y_Riv, Dif_Y_Riv, Grad_Y_Riv, Wid, Wid_down, Avg_Wid, Avg_Y_Sub, Dif_Y_Sub, Avg_Ksat, Grad_Y_Sub, inabr, effK, effKnabr, TotalY_Ele, TotalY_Ele_down)
+#endif
+        for (i = 0; i < MD->NumRiv; i++)
+        {
+            TotalY_Riv = MD->DummyY[i + 3 * MD->NumEle] + MD->Riv[i].zmin;
+            Perem = MD->RivPerem[i];
+            if (MD->Riv[i].down > 0)
+            {
+
+                /****************************************************************/
+                /*
+                 * Lateral Flux Calculation between River-River element Follows 
+                 */
+
+                /****************************************************************/
+                TotalY_Riv_down = MD->DummyY[MD->Riv[i].down - 1 + 3 * MD->NumEle] + MD->Riv[MD->Riv[i].down - 1].zmin;
+                Perem_down = MD->RivPerem[MD->Riv[i].down - 1];
+                Avg_Perem = (Perem + Perem_down) / 2.0;
+                Avg_Rough = (MD->Riv_Mat[MD->Riv[i].material - 1].Rough + MD->Riv_Mat[MD->Riv[MD->Riv[i].down - 1].material - 1].Rough) / 2.0;
+                Distance = MD->Riv[i].distDown;
+                Dif_Y_Riv = (RIV_MODE == 1) ? (MD->Riv[i].zmin - MD->Riv[MD->Riv[i].down - 1].zmin) : (TotalY_Riv - TotalY_Riv_down);
+                Grad_Y_Riv = Dif_Y_Riv / Distance;
+                Avg_Sf = (Grad_Y_Riv > 0) ? Grad_Y_Riv : EPS;
+                CrossA = MD->RivArea[i];
+                CrossAdown = MD->RivArea[MD->Riv[i].down - 1];
+                AvgCrossA = 0.5 * (CrossA + CrossAdown);
+                Avg_Y_Riv = (Avg_Perem == 0) ? 0 : (AvgCrossA / Avg_Perem);
+                OverlandFlow (MD->FluxRiv, i, 1, Avg_Y_Riv, Grad_Y_Riv, Avg_Sf, CrossA, Avg_Rough);
+
+                /*
+                 * Lateral Flux Calculation between Element Beneath River (EBR) and EBR 
+                 */
+                TotalY_Ele = MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv] + MD->EleZmin[i + MD->NumEle];
+                TotalY_Ele_down = MD->DummyY[MD->Riv[i].down - 1 + 3 * MD->NumEle + MD->NumRiv] + MD->EleZmin[MD->Riv[i].down - 1 + MD->NumEle];
+                Wid = MD->Riv[i].bankWid;
+                Wid_down = MD->Riv[MD->Riv[i].down - 1].bankWid;
+                Avg_Wid = (Wid + Wid_down) / 2.0;
+                Distance = MD->Riv[i].distDown;
+                Dif_Y_Sub = TotalY_Ele - TotalY_Ele_down;
+                //              Avg_Y_Sub=avgY(MD->Ele[i+MD->NumEle].zmin,MD->Ele[MD->Riv[i].down - 1+MD->NumEle].zmin,MD->DummyY[i + 3*MD->NumEle+MD->NumRiv],MD->DummyY[MD->Riv[i].down - 1 + 3*MD->NumEle+MD->NumRiv]);
+                Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv], MD->DummyY[MD->Riv[i].down - 1 + 3 * MD->NumEle + MD->NumRiv]);
+                Grad_Y_Sub = Dif_Y_Sub / Distance;
+                /*
+                 * take care of macropore effect 
+                 */
+                //                      effK=MD->Ele[i+MD->NumEle].KsatH;
+                effK = MD->RivEffKH[i];
+                inabr = MD->Riv[i].down - 1;
+                //                      effKnabr=MD->Ele[inabr+MD->NumEle].KsatH;
+                effKnabr = MD->RivEffKH[inabr];
+                Avg_Ksat = 0.5 * (effK + effKnabr);
+                /*
+                 * groundwater flow modeled by Darcy's law 
+                 */
+                MD->FluxRiv[i][9] = Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub * Avg_Wid;
+            }
+            else
+            {
+                switch (MD->Riv[i].down)
+                {
+                    case -1:
+                        /*
+                         * Dirichlet boundary condition 
+                         */
+                        TotalY_Riv_down = Interpolation (&MD->TSD_Riv[(MD->Riv[i].BC) - 1], t) + (MD->Node[MD->Riv[i].ToNode - 1].zmax - MD->Riv[i].depth);
+                        Distance = MD->Riv[i].distOut;
+                        Grad_Y_Riv = (TotalY_Riv - TotalY_Riv_down) / Distance;
+                        /*
+                         * Note: do i need to change else part here for diff wave 
+                         */
+                        Avg_Sf = (RIV_MODE == 1) ? Grad_Y_Riv : Grad_Y_Riv;
+                        Avg_Rough = MD->Riv_Mat[MD->Riv[i].material - 1].Rough;
+                        Avg_Y_Riv = avgY (Grad_Y_Riv, MD->DummyY[i + 3 * MD->NumEle], Interpolation (&MD->TSD_Riv[(MD->Riv[i].BC) - 1], t));
+                        Avg_Perem = Perem;
+                        CrossA = MD->RivArea[i];
+                        Avg_Y_Riv = (Perem == 0) ? 0 : (CrossA / Avg_Perem);
+                        OverlandFlow (MD->FluxRiv, i, 1, Avg_Y_Riv, Grad_Y_Riv, Avg_Sf, CrossA, Avg_Rough);
+                        break;
+                    case -2:
+                        /*
+                         * Neumann boundary condition 
+                         */
+                        MD->FluxRiv[i][1] = Interpolation (&MD->TSD_Riv[MD->Riv[i].BC - 1], t);
+                        break;
+                    case -3:
+                        /*
+                         * zero-depth-gradient boundary conditions 
+                         */
+                        Distance = MD->Riv[i].distOut;
+                        Grad_Y_Riv = (MD->Riv[i].zmin - (MD->Node[MD->Riv[i].ToNode - 1].zmax - MD->Riv[i].depth)) / Distance;
+                        Avg_Rough = MD->Riv_Mat[MD->Riv[i].material - 1].Rough;
+                        Avg_Y_Riv = MD->DummyY[i + 3 * MD->NumEle];
+                        Avg_Perem = Perem;
+                        CrossA = MD->RivArea[i];
+                        MD->FluxRiv[i][1] = sqrt (Grad_Y_Riv) * CrossA * ((Avg_Perem > 0) ? pow (CrossA / Avg_Perem, 2.0 / 3.0) : 0) / Avg_Rough;
+                        break;
+                    case -4:
+                        /*
+                         * Critical Depth boundary conditions 
+                         */
+                        CrossA = MD->RivArea[i];
+                        MD->FluxRiv[i][1] = CrossA * sqrt (GRAV * MD->DummyY[i + 3 * MD->NumEle]);    /* Note the dependence on physical units */
+                        break;
+                    default:
+                        printf ("Fatal Error: River Routing Boundary Condition Type Is Wrong!");
+                        exit (1);
+                }
+                /*
+                 * Note: bdd condition for subsurface element can be changed. Assumption: No flow condition 
+                 */
+                MD->FluxRiv[i][9] = 0;
+            }
+            if (MD->Riv[i].LeftEle > 0)
+            {
+
+                /*
+                 * Lateral Surface Flux Calculation between River-Triangular element Follows 
+                 */
+                OLFeleToriv (MD->DummyY[MD->Riv[i].LeftEle - 1] + MD->EleZmax[MD->Riv[i].LeftEle - 1], MD->EleZmax[MD->Riv[i].LeftEle - 1], MD->Riv_Mat[MD->Riv[i].material - 1].Cwr, MD->Riv[i].zmax, TotalY_Riv, MD->FluxRiv, i, 2, MD->Riv[i].Length);
+                /*
+                 * Bank overland flow is limited by the element-element flux of
+                 * the bank edge, before that edge is replaced by the bank flux 
+                 */
+                if (MD->Riv[i].leftEdge >= 0 && -MD->FluxRiv[i][2] > 0 && -MD->FluxRiv[i][2] > MD->FluxSurf[MD->Riv[i].LeftEle - 1][MD->Riv[i].leftEdge])
+                    MD->FluxRiv[i][2] = -MD->DummyY[MD->Riv[i].LeftEle - 1] / dt;
+
+                /*
+                 * Lateral Sub-surface Flux Calculation between River-Triangular element Follows 
+                 */
+                Dif_Y_Sub = (MD->DummyY[i + 3 * MD->NumEle] + MD->Riv[i].zmin) - (MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle] + MD->EleZmin[MD->Riv[i].LeftEle - 1]);
+                //          Avg_Y_Sub=(MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle]+MD->Ele[MD->Riv[i].LeftEle-1].zmin-MD->Riv[i].zmin)>0?MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle]+MD->Ele[MD->Riv[i].LeftEle-1].zmin-MD->Riv[i].zmin:0;
+                /*
+                 * This is head at river edge representation 
+                 */
+                //          Avg_Y_Sub = ((MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].LeftEle-1].zmax-MD->Ele[MD->Riv[i].LeftEle-1].zmin)+MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle])>MD->Riv[i].zmin)?((MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].LeftEle-1].zmax-MD->Ele[MD->Riv[i].LeftEle-1].zmin)+MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle])-MD->Riv[i].zmin):0;
+                /*
+                 * This is head in neighboring cell represention 
+                 */
+                Avg_Y_Sub = MD->EleZmin[MD->Riv[i].LeftEle - 1] > MD->Riv[i].zmin ? MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle] : ((MD->EleZmin[MD->Riv[i].LeftEle - 1] + MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle]) > MD->Riv[i].zmin ? (MD->EleZmin[MD->Riv[i].LeftEle - 1] + MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle] - MD->Riv[i].zmin) : 0);
+                //          Avg_Y_Sub=avgY(MD->Riv[i].zmin,MD->Riv[i].zmin,MD->DummyY[i+3*MD->NumEle],Avg_Y_Sub);
+                Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 3 * MD->NumEle], Avg_Y_Sub);
+                effK = MD->Riv[i].KsatH;
+                Distance = MD->Riv[i].distLeft;
+                Grad_Y_Sub = Dif_Y_Sub / Distance;
+                /*
+                 * take care of macropore effect 
+                 */
+                inabr = MD->Riv[i].LeftEle - 1;
+                effKnabr = MD->EleEffKH[inabr];
+                Avg_Ksat = 0.5 * (effK + effKnabr);
+                MD->FluxRiv[i][4] = MD->Riv[i].Length * Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub;
+
+                /*
+                 * Lateral Flux between rectangular element (beneath river) and triangular element 
+                 */
+                Dif_Y_Sub = (MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv] + MD->EleZmin[i + MD->NumEle]) - (MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle] + MD->EleZmin[MD->Riv[i].LeftEle - 1]);
+                //          Avg_Y_Sub=((MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle]+MD->Ele[MD->Riv[i].LeftEle-1].zmin-MD->Riv[i].zmin)>0)?MD->Riv[i].zmin-MD->Ele[MD->Riv[i].LeftEle-1].zmin:MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle];
+                /*
+                 * This is head at river edge representation 
+                 */
+                //          Avg_Y_Sub = ((MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].LeftEle-1].zmax-MD->Ele[MD->Riv[i].LeftEle-1].zmin)+MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle])>MD->Riv[i].zmin)?MD->Riv[i].zmin-(MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].LeftEle-1].zmax-MD->Ele[MD->Riv[i].LeftEle-1].zmin)):MD->DummyY[MD->Riv[i].LeftEle-1 + 2*MD->NumEle];
+                /*
+                 * This is head in neighboring cell represention 
+                 */
+                Avg_Y_Sub = MD->EleZmin[MD->Riv[i].LeftEle - 1] > MD->Riv[i].zmin ? 0 : ((MD->EleZmin[MD->Riv[i].LeftEle - 1] + MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle]) > MD->Riv[i].zmin ? (MD->Riv[i].zmin - MD->EleZmin[MD->Riv[i].LeftEle - 1]) : MD->DummyY[MD->Riv[i].LeftEle - 1 + 2 * MD->NumEle]);
+                //          Avg_Y_Sub=avgY(MD->Ele[i+MD->NumEle].zmin,MD->Ele[MD->Riv[i].LeftEle-1].zmin,MD->DummyY[i+3*MD->NumEle+MD->NumRiv],Avg_Y_Sub); 
+                Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv], Avg_Y_Sub);
+                //          effK=MD->Ele[i+MD->NumEle].KsatH;
+                effK = MD->RivEffKH[i];
+                inabr = MD->Riv[i].LeftEle - 1;
+                effKnabr = MD->EleEffKH[inabr];
+                Avg_Ksat = 0.5 * (effK + effKnabr);
+                Grad_Y_Sub = Dif_Y_Sub / Distance;  /* take care of macropore effect */
+                MD->FluxRiv[i][7] = MD->Riv[i].Length * Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub;
+            }
+            if (MD->Riv[i].RightEle > 0)
+            {
+
+                /*
+                 * Lateral Surface Flux Calculation between River-Triangular element Follows 
+                 */
+                OLFeleToriv (MD->DummyY[MD->Riv[i].RightEle - 1] + MD->EleZmax[MD->Riv[i].RightEle - 1], MD->EleZmax[MD->Riv[i].RightEle - 1], MD->Riv_Mat[MD->Riv[i].material - 1].Cwr, MD->Riv[i].zmax, TotalY_Riv, MD->FluxRiv, i, 3, MD->Riv[i].Length);
+                /*
+                 * Bank overland flow is limited by the element-element flux of
+                 * the bank edge, before that edge is replaced by the bank flux 
+                 */
+                if (MD->Riv[i].rightEdge >= 0 && -MD->FluxRiv[i][3] > 0 && -MD->FluxRiv[i][3] > MD->FluxSurf[MD->Riv[i].RightEle - 1][MD->Riv[i].rightEdge])
+                    MD->FluxRiv[i][3] = -MD->DummyY[MD->Riv[i].RightEle - 1] / dt;
+
+                /*
+                 * Lateral Sub-surface Flux Calculation between River-Triangular element Follows 
+                 */
+                Dif_Y_Sub = (MD->DummyY[i + 3 * MD->NumEle] + MD->Riv[i].zmin) - (MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle] + MD->EleZmin[MD->Riv[i].RightEle - 1]);
+                //          Avg_Y_Sub=(MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle]+MD->Ele[MD->Riv[i].RightEle-1].zmin-MD->Riv[i].zmin>0)?MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle]+MD->Ele[MD->Riv[i].RightEle-1].zmin-MD->Riv[i].zmin:0;
+                /*
+                 * This is head at river edge representation 
+                 */
+                //          Avg_Y_Sub = ((MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].RightEle-1].zmax-MD->Ele[MD->Riv[i].RightEle-1].zmin)+MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle])>MD->Riv[i].zmin)?((MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].RightEle-1].zmax-MD->Ele[MD->Riv[i].RightEle-1].zmin)+MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle])-MD->Riv[i].zmin):0;
+                /*
+                 * This is head in neighboring cell represention 
+                 */
+                Avg_Y_Sub = MD->EleZmin[MD->Riv[i].RightEle - 1] > MD->Riv[i].zmin ? MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle] : ((MD->EleZmin[MD->Riv[i].RightEle - 1] + MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle]) > MD->Riv[i].zmin ? (MD->EleZmin[MD->Riv[i].RightEle - 1] + MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle] - MD->Riv[i].zmin) : 0);
+                //          Avg_Y_Sub=avgY(MD->Riv[i].zmin,MD->Riv[i].zmin,MD->DummyY[i+3*MD->NumEle],Avg_Y_Sub);
+                Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 3 * MD->NumEle], Avg_Y_Sub);
+                effK = MD->Riv[i].KsatH;
+                Distance = MD->Riv[i].distRight;
+                Grad_Y_Sub = Dif_Y_Sub / Distance;
+                /*
+                 * take care of macropore effect 
+                 */
+                inabr = MD->Riv[i].RightEle - 1;
+                effKnabr = MD->EleEffKH[inabr];
+                Avg_Ksat = 0.5 * (effK + effKnabr);
+                MD->FluxRiv[i][5] = MD->Riv[i].Length * Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub;
+
+                /*
+                 * Lateral Flux between rectangular element (beneath river) and triangular element 
+                 */
+                Dif_Y_Sub = (MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv] + MD->EleZmin[i + MD->NumEle]) - (MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle] + MD->EleZmin[MD->Riv[i].RightEle - 1]);
+                //          Avg_Y_Sub=((MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle]+MD->Ele[MD->Riv[i].RightEle-1].zmin-MD->Riv[i].zmin)>0)?MD->Riv[i].zmin-MD->Ele[MD->Riv[i].RightEle-1].zmin:MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle];
+                /*
+                 * This is head at river edge representation 
+                 */
+                //          Avg_Y_Sub = ((MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].RightEle-1].zmax-MD->Ele[MD->Riv[i].RightEle-1].zmin)+MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle])>MD->Riv[i].zmin)?MD->Riv[i].zmin-(MD->Riv[i].zmax-(MD->Ele[MD->Riv[i].RightEle-1].zmax-MD->Ele[MD->Riv[i].RightEle-1].zmin)):MD->DummyY[MD->Riv[i].RightEle-1 + 2*MD->NumEle];
+                /*
+                 * This is head in neighboring cell represention 
+                 */
+                Avg_Y_Sub = MD->EleZmin[MD->Riv[i].RightEle - 1] > MD->Riv[i].zmin ? 0 : ((MD->EleZmin[MD->Riv[i].RightEle - 1] + MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle]) > MD->Riv[i].zmin ? (MD->Riv[i].zmin - MD->EleZmin[MD->Riv[i].RightEle - 1]) : MD->DummyY[MD->Riv[i].RightEle - 1 + 2 * MD->NumEle]);
+                //          Avg_Y_Sub=avgY(MD->Ele[i+MD->NumEle].zmin,MD->Ele[MD->Riv[i].RightEle-1].zmin,MD->DummyY[i+3*MD->NumEle+MD->NumRiv],Avg_Y_Sub); 
+                Avg_Y_Sub = avgY (Dif_Y_Sub, MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv], Avg_Y_Sub);
+                //          effK=MD->Ele[i+MD->NumEle].KsatH;
+                effK = MD->RivEffKH[i];
+                inabr = MD->Riv[i].RightEle - 1;
+                effKnabr = MD->EleEffKH[inabr];
+                Avg_Ksat = 0.5 * (effK + effKnabr);
+                Grad_Y_Sub = Dif_Y_Sub / Distance;  /* take care of macropore effect */
+                MD->FluxRiv[i][8] = MD->Riv[i].Length * Avg_Ksat * Grad_Y_Sub * Avg_Y_Sub;
+            }
+            Avg_Wid = CS_Width (MD->Riv_Shape[MD->Riv[i].shape - 1].interpOrd, MD->DummyY[i + 3 * MD->NumEle], MD->Riv[i].coeff);
+            Dif_Y_Riv = (MD->Riv[i].zmin - (MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv] + MD->EleZmin[i + MD->NumEle])) > 0 ? MD->DummyY[i + 3 * MD->NumEle] : MD->DummyY[i + 3 * MD->NumEle] + MD->Riv[i].zmin - (MD->DummyY[i + 3 * MD->NumEle + MD->NumRiv] + MD->EleZmin[i + MD->NumEle]);
+            Grad_Y_Riv = Dif_Y_Riv / MD->Riv[i].bedThick;
+            MD->FluxRiv[i][6] = MD->Riv[i].KsatV * Avg_Wid * MD->Riv[i].Length * Grad_Y_Riv;
+        }
+
+        /*
+         * Element-local work in a single sweep: vertical fluxes, replacement of
+         * river bank edge fluxes, and assembly of DY. Each element only writes
+         * its own fluxes and states, and the bank flux of its own side of a
+         * river segment 
+         */
+#ifdef _OPENMP
+#pragma omp for private (j, inabr, Avg_Y_Sub, Grad_Y_Sub, AquiferDepth, Deficit, elemSatn, satKfunc, effK, TotalY_Ele)
+#endif
+        for (i = 0; i < MD->NumEle; i++)
+        {
+            AquiferDepth = (MD->EleZmax[i] - MD->EleZmin[i]);
+
+            /*
+             * Note: Assumption is OVL flow depth less than EPS/100 is immobile water 
+             */
+            if (MD->DummyY[i + 2 * MD->NumEle] > AquiferDepth - MD->Ele[i].infD)
+            {
+                /*
+                 * Assumption: infD<macD 
+                 */
+                Grad_Y_Sub = (MD->DummyY[i] + MD->EleZmax[i] - (MD->DummyY[i + 2 * MD->NumEle] + MD->EleZmin[i])) / MD->Ele[i].infD;
+                Grad_Y_Sub = ((MD->DummyY[i] < EPS / 100) && (Grad_Y_Sub > 0)) ? 0 : Grad_Y_Sub;
+                elemSatn = 1.0;
+                satKfunc = vgKr (&MD->VGTbl[MD->Ele[i].soil - 1], elemSatn, MD->EleBeta[i]);
+                effK = (MD->Ele[i].Macropore == 1) ? effKV (satKfunc, Grad_Y_Sub, MD->Ele[i].macKsatV, MD->Ele[i].infKsatV, MD->Ele[i].hAreaF) : MD->Ele[i].infKsatV;
+#ifdef _FLUX_PIHM_
+                MD->EleViR[i] = MD->EleFCR[i] * effK * Grad_Y_Sub;
+#else
+                MD->EleViR[i] = effK * Grad_Y_Sub;
+#endif
+
+#ifdef _FLUX_PIHM_
+                if (MD->DummyY[i] + (MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i] - MD->EleViR[i]) * dt < 0)
+#else
+                if (MD->DummyY[i] + (MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i] - MD->EleViR[i] - (MD->DummyY[i] < (EPS / 100) ? 0 : MD->EleET[i][2])) * dt < 0)
+#endif
+                {
+#ifdef _FLUX_PIHM_
+                    MD->EleViR[i] = MD->DummyY[i] / dt + MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i];
+#else
+                    MD->EleViR[i] = MD->DummyY[i] / dt + MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i] - (MD->DummyY[i] < (EPS / 100) ? 0 : MD->EleET[i][2]);
+#endif
+                    MD->EleViR[i] = MD->EleViR[i] < 0 ? 0 : MD->EleViR[i];
+                }
+                MD->Recharge[i] = MD->EleViR[i];
+                DY[i + MD->NumEle] = DY[i + MD->NumEle] + MD->EleViR[i] - MD->Recharge[i];
+#ifdef _FLUX_PIHM_
+                DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] + MD->Recharge[i] - MD->EleET[i][2];
+#else
+                DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] + MD->Recharge[i] - (MD->DummyY[i] < (EPS / 100) ? MD->EleET[i][2] : 0);
+#endif
+            }
+            else
+            {
+                Deficit = AquiferDepth - MD->DummyY[i + 2 * MD->NumEle];
+                //          elemSatn = elemSatn>1?1:elemSatn;
+                elemSatn = 1.0;
+                satKfunc = vgKr (&MD->VGTbl[MD->Ele[i].soil - 1], elemSatn, MD->EleBeta[i]);
+                /* Note: for psi calculation using van genuchten relation, cutting the psi-sat tail at small saturation can be performed for computational advantage. If you dont' want to perform this, comment the statement that follows */
+#ifdef _FLUX_PIHM_
+                elemSatn = MD->SfcSat[i];   //(MD->EleSW[i][0]-MD->Ele[i].ThetaR)/(MD->Ele[i].ThetaS - MD->Ele[i].ThetaR);
+#else
+                elemSatn = ((MD->DummyY[i + MD->NumEle] / Deficit) > 1) ? 1 : ((MD->DummyY[i + MD->NumEle] <= 0) ? EPS / 1000.0 : MD->DummyY[i + MD->NumEle] / Deficit);
+#endif
+                //          printf("elemSatn = %f, SW = %f, ThetaS = %f, ThetaR = %f, soiltype = %d\n", elemSatn, MD->EleSW[i][0], MD->Ele[i].ThetaS, MD->Ele[i].ThetaR, MD->Ele[i].geol);
+                elemSatn = elemSatn > 1. ? 1. : elemSatn;
+                elemSatn = (elemSatn < multF * EPS) ? (multF * EPS) : elemSatn;
+                Avg_Y_Sub = -vgHead (&MD->VGTbl[MD->Ele[i].soil - 1], elemSatn, MD->EleBeta[i]) / MD->EleAlpha[i];
+                Avg_Y_Sub = (Avg_Y_Sub < MINpsi) ? MINpsi : Avg_Y_Sub;
+                TotalY_Ele = Avg_Y_Sub + MD->EleZmin[i] + AquiferDepth - MD->Ele[i].infD;
+                Grad_Y_Sub = (MD->DummyY[i] + MD->EleZmax[i] - TotalY_Ele) / MD->Ele[i].infD;
+                Grad_Y_Sub = ((MD->DummyY[i] < EPS / 100) && (Grad_Y_Sub > 0)) ? 0 : Grad_Y_Sub;
+                //          satKfunc = satKfunc<0.13?0.13:satKfunc;
+                effK = (MD->Ele[i].Macropore == 1) ? effKV (satKfunc, Grad_Y_Sub, MD->Ele[i].macKsatV, MD->Ele[i].infKsatV, MD->Ele[i].hAreaF) : MD->Ele[i].infKsatV;
+                //          MD->Ele[i].effKV = effK;
+                //              MD->EleViR[i] = 0.5*(effK+MD->Ele[i].infKsatV)*Grad_Y_Sub;
+#ifdef _FLUX_PIHM_
+                MD->EleViR[i] = MD->EleFCR[i] * 0.5 * (effK) * Grad_Y_Sub;
+#else
+                MD->EleViR[i] = 0.5 * (effK) * Grad_Y_Sub;
+#endif
+
+#ifdef _FLUX_PIHM_
+                if (MD->DummyY[i] + (MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i] - MD->EleViR[i]) * dt < 0)
+#else
+                if (MD->DummyY[i] + (MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i] - MD->EleViR[i] - (MD->DummyY[i] < EPS / 100 ? 0 : MD->EleET[i][2])) * dt < 0)
+#endif
+                {
+#ifdef _FLUX_PIHM_
+                    MD->EleViR[i] = MD->DummyY[i] / dt + MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i];
+#else
+                    MD->EleViR[i] = MD->DummyY[i] / dt + MD->EleNetPrep[i] + (MD->FluxSurf[i][0] + MD->FluxSurf[i][1] + MD->FluxSurf[i][2]) / MD->EleArea[i] - (MD->DummyY[i] < EPS / 100 ? 0 : MD->EleET[i][2]);
+#endif
+                    MD->EleViR[i] = MD->EleViR[i] < 0 ? 0 : MD->EleViR[i];
+                }
+                /*
+                 * Harmonic mean formulation. Note that if unsaturated zone has low saturation, satKfunc becomes very small. Use arithmetic mean instead
+                 */
+                //                  MD->Recharge[i] = (elemSatn==0.0)?0:(Deficit<=0)?0:(MD->Ele[i].KsatV*satKfunc*(MD->Ele[i].Alpha*Deficit-2*pow(-1+pow(elemSatn,MD->Ele[i].Beta/(-MD->Ele[i].Beta+1)),1/MD->Ele[i].Beta))/(MD->Ele[i].Alpha*((Deficit+MD->DummyY[i+2*MD->NumEle]*satKfunc))));
+                /*
+                 * Arithmetic Mean Formulation 
+                 */
+                elemSatn = ((MD->DummyY[i + MD->NumEle] / Deficit) > 1) ? 1 : ((MD->DummyY[i + MD->NumEle] <= 0) ? (EPS / 100.0) : (MD->DummyY[i + MD->NumEle] / Deficit));
+                elemSatn = (elemSatn < multF * EPS) ? (multF * EPS) : elemSatn;
+                satKfunc = vgKr (&MD->VGTbl[MD->Ele[i].soil - 1], elemSatn, MD->EleBeta[i]);
+                satKfunc = satKfunc < 0.13 ? 0.13 : satKfunc;
+                //          effK=(MD->Ele[i].Macropore==1)?((MD->DummyY[i+2*MD->NumEle]>AquiferDepth-MD->Ele[i].macD)?effK:(MD->Ele[i].KsatV*satKfunc)):(MD->Ele[i].KsatV*satKfunc);
+                Avg_Y_Sub = -vgHead (&MD->VGTbl[MD->Ele[i].soil - 1], elemSatn, MD->EleBeta[i]) / MD->EleAlpha[i];
+                Avg_Y_Sub = (Avg_Y_Sub < MINpsi) ? MINpsi : Avg_Y_Sub;
+                TotalY_Ele = Avg_Y_Sub + MD->EleZmax[i] - 0.5 * Deficit;
+                Grad_Y_Sub = (TotalY_Ele - (MD->EleZmax[i] - Deficit)) / (0.5 * AquiferDepth);
+                //(MD->DummyY[i]+MD->Ele[i].zmax-TotalY_Ele)/MD->Ele[i].infD;
+                //          Grad_Y_Sub=((MD->DummyY[i]<EPS/100)&&(Grad_Y_Sub>0))?0:Grad_Y_Sub;
+                effK = (MD->Ele[i].Macropore == 1) ? ((MD->DummyY[i + 2 * MD->NumEle] > AquiferDepth - MD->Ele[i].macD) ? effKV (satKfunc, Grad_Y_Sub, MD->Ele[i].macKsatV, MD->EleKsatV[i], MD->Ele[i].hAreaF) : (MD->EleKsatV[i] * satKfunc)) : (MD->EleKsatV[i] * satKfunc);
+
+                MD->Recharge[i] = (elemSatn == 0.0) ? 0 : ((Deficit <= 0) ? 0 : (MD->EleKsatV[i] * MD->DummyY[i + 2 * MD->NumEle] + effK * Deficit) * (MD->EleAlpha[i] * Deficit - 2 * vgHead (&MD->VGTbl[MD->Ele[i].soil - 1], elemSatn, MD->EleBeta[i])) / (MD->EleAlpha[i] * pow (Deficit + MD->DummyY[i + 2 * MD->NumEle], 2)));
+                MD->Recharge[i] = (MD->Recharge[i] > 0 && MD->DummyY[i + MD->NumEle] <= 0) ? 0 : MD->Recharge[i];   //??BHATT
+                MD->Recharge[i] = (MD->Recharge[i] < 0 && MD->DummyY[i + 2 * MD->NumEle] <= 0) ? 0 : MD->Recharge[i];   //??BHATT
+
+                //          MD->EleET[i][2]=(MD->DummyY[i]<EPS/100)?elemSatn*MD->EleET[i][2]:MD->EleET[i][2];
+#ifdef _FLUX_PIHM_
+                DY[i + MD->NumEle] = DY[i + MD->NumEle] + MD->EleViR[i] - MD->Recharge[i] - MD->EleET[i][2];
+#else
+                DY[i + MD->NumEle] = DY[i + MD->NumEle] + MD->EleViR[i] - MD->Recharge[i] - ((MD->DummyY[i] < EPS / 100) ? MD->EleET[i][2] : 0);
+#endif
+                DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] + MD->Recharge[i];
+            }
+#ifdef _FLUX_PIHM_
+            DY[i] = DY[i] + MD->EleNetPrep[i] - MD->EleViR[i];
+            DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] - MD->EleETsat[i] * MD->EleET[i][1];
+            DY[i + MD->NumEle] = DY[i + MD->NumEle] - (1 - MD->EleETsat[i]) * MD->EleET[i][1];
+#else
+            DY[i] = DY[i] + MD->EleNetPrep[i] - MD->EleViR[i] - ((MD->DummyY[i] < EPS / 100) ? 0 : MD->EleET[i][2]);
+            if (MD->DummyY[i + 2 * MD->NumEle] > AquiferDepth - MD->Ele[i].RzD)
+                DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] - MD->EleET[i][1];
+            else
+                DY[i + MD->NumEle] = DY[i + MD->NumEle] - MD->EleET[i][1];
+#endif
+
+            /*
+             * Note: the infiltration limit above uses element-element fluxes of
+             * river edges; they are replaced by bank fluxes here 
+             */
+            for (j = 0; j < 3; j++)
+            {
+                if (MD->Ele[i].BC[j] <= -4)
+                {
+                    inabr = -(MD->Ele[i].BC[j] / 4) - 1;
+                    if (MD->Riv[inabr].LeftEle - 1 == i)
+                    {
+                        MD->FluxSurf[i][j] = -MD->FluxRiv[inabr][2];
+                        MD->FluxSub[i][j] = -MD->FluxRiv[inabr][4];
+                        MD->FluxSub[i][j] = MD->FluxSub[i][j] - MD->FluxRiv[inabr][7];
+                    }
+                    else
+                    {
+                        MD->FluxSurf[i][j] = -MD->FluxRiv[inabr][3];
+                        MD->FluxSub[i][j] = -MD->FluxRiv[inabr][5];
+                        MD->FluxSub[i][j] = MD->FluxSub[i][j] - MD->FluxRiv[inabr][8];
+                    }
+                }
+            }
+
+            for (j = 0; j < 3; j++)
+            {
+                DY[i] = DY[i] - MD->FluxSurf[i][j] / MD->EleArea[i];
+                DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] - MD->FluxSub[i][j] / MD->EleArea[i];
+            }
+            DY[i + MD->NumEle] = DY[i + MD->NumEle] / MD->ElePorosity[i];
+            DY[i + 2 * MD->NumEle] = DY[i + 2 * MD->NumEle] / MD->ElePorosity[i];
+        }
+        /*
+         * In-flow of each segment is gathered from the out-flow of its upstream
+         * segments, so every segment only writes its own entries 
+         */
+#ifdef _OPENMP
+#pragma omp for private (j, k)
+#endif
+        for (i = 0; i < MD->NumRiv; i++)
+        {
+            /*
+             * [0] for inflow, [1] for outflow; [10] for inflow, [9] for outflow 
+             */
+            MD->FluxRiv[i][0] = 0;
+            MD->FluxRiv[i][10] = 0;
+            for (k = 0; k < MD->Riv[i].numUp; k++)
+            {
+                MD->FluxRiv[i][0] = MD->FluxRiv[i][0] - MD->FluxRiv[MD->Riv[i].up[k] - 1][1];
+                MD->FluxRiv[i][10] = MD->FluxRiv[i][10] - MD->FluxRiv[MD->Riv[i].up[k] - 1][9];
+            }
+            for (j = 0; j <= 6; j++)
+            {
+                /*
+                 * Note the limitation due to d(v)/dt=a*dy/dt+y*da/dt for CS other than rectangle 
+                 */
+                DY[i + 3 * MD->NumEle] = DY[i + 3 * MD->NumEle] - MD->FluxRiv[i][j] / (MD->Riv[i].Length * MD->Riv[i].bankWid);
+            }
+            //      MD->EleEp[i+MD->NumEle] = MD->DummyY[i+3*MD->NumEle]<EPS/100?0:MD->EleEp[i+MD->NumEle];
+            //      DY[i+3*MD->NumEle] = DY[i+3*MD->NumEle] + MD->EleNetPrep[i+MD->NumEle] - MD->EleEp[i+MD->NumEle];
+    //        DY[i + 3 * MD->NumEle] = DY[i + 3 * MD->NumEle];
+            DY[i + 3 * MD->NumEle + MD->NumRiv] = DY[i + 3 * MD->NumEle + MD->NumRiv] - MD->FluxRiv[i][7] - MD->FluxRiv[i][8] - MD->FluxRiv[i][9] - MD->FluxRiv[i][10] + MD->FluxRiv[i][6];
+            DY[i + 3 * MD->NumEle + MD->NumRiv] = DY[i + 3 * MD->NumEle + MD->NumRiv] / (MD->ElePorosity[i + MD->NumEle] * MD->Riv[i].Length * MD->Riv[i].bankWid);
+        }
+    }
+//      printf("Flux: %f, %f\n", MD->Recharge[120], (MD->FluxSub[120][0] + MD->FluxSub[120][1] + MD->FluxSub[120][2])/ MD->Ele[120].area);
+    return 0;
+}
+
+#undef RHS_FUNC
+#undef EDGE_FUNC
+#undef SURF_MODE
+#undef RIV_MODE
@@ -0,0 +1,39 @@
+#ifndef FIXED_SUM_HEADER
+#define FIXED_SUM_HEADER
+
+/*
+ * Fixed summation tree shared by FixedSum () and the reductions of the
+ * threaded N_Vector. The range [0, n) is cut into SUM_BLOCKS contiguous
+ * blocks, block () sums one block in order, and the block sums are then
+ * added in order. The grouping depends only on n, so the result is the
+ * same for any number of threads. Blocks are summed by threads only when
+ * n > thread_min. Include after pihm.h
+ */
+typedef realtype (*block_sum_fn) (long int lo, long int hi, const void *arg);
+
+static realtype FixedTreeSum (block_sum_fn block, const void *arg, long int n, long int thread_min)
+{
+    realtype        partial[SUM_BLOCKS];
+    realtype        sum;
+    long int        lo, hi, len;
+    int             b;
+
+    len = (n + SUM_BLOCKS - 1) / SUM_BLOCKS;
+
+#ifdef _OPENMP
+#pragma omp parallel for private (lo, hi) if (n > thread_min)
+#endif
+    for (b = 0; b < SUM_BLOCKS; b++)
+    {
+        lo = b * len;
+        hi = (lo + len < n) ? lo + len : n;
+        partial[b] = block (lo, hi, arg);
+    }
+
+    sum = 0.;
+    for (b = 0; b < SUM_BLOCKS; b++)
+        sum = sum + partial[b];
+    return sum;
+}
+
+#endif
@@ -8,8 +8,8 @@
 
 realtype monthly_lai (realtype t, int LC_type)
 {
-    time_t         *rawtime;
-    struct tm      *timestamp;
+    time_t          rawtime;
+    struct tm       timestamp;
 
     realtype        lai_tbl[20][12] = {
                     {8.760, 9.160, 9.827, 10.09, 10.36, 10.76, 10.49, 10.23, 10.09, 9.827, 9.160, 8.760},
@@ -31,17 +31,16 @@ realtype monthly_lai (realtype t, int LC_type)
                     {999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0},
                     {999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0}};
 
-    rawtime = (time_t *) malloc (sizeof (time_t));
-    *rawtime = (int) t;
-    timestamp = gmtime (rawtime);
+    rawtime = (int) t;
+    gmtime_r (&rawtime, &timestamp);
 
-    return (lai_tbl[LC_type - 1][timestamp->tm_mon]);
+    return (lai_tbl[LC_type - 1][timestamp.tm_mon]);
 }
 
 realtype monthly_rl (realtype t, int LC_type)
 {
-    time_t         *rawtime;
-    struct tm      *timestamp;
+    time_t          rawtime;
+    struct tm       timestamp;
 
     realtype        rl_tbl[20][12] = {
                     {1.112, 1.103, 1.088, 1.082, 1.076, 1.068, 1.073, 1.079, 1.082, 1.088, 1.103, 1.112},
@@ -65,25 +64,23 @@ realtype monthly_rl (realtype t, int LC_type)
                     {999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0},
                     {999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0, 999.0}};
 
-    rawtime = (time_t *) malloc (sizeof (time_t));
-    *rawtime = (int) t;
-    timestamp = gmtime (rawtime);
+    rawtime = (int) t;
+    gmtime_r (&rawtime, &timestamp);
 
-    return (rl_tbl[LC_type - 1][timestamp->tm_mon]);
+    return (rl_tbl[LC_type - 1][timestamp.tm_mon]);
 }
 
 realtype monthly_mf (realtype t)
 {
-    time_t         *rawtime;
-    struct tm      *timestamp;
+    time_t          rawtime;
+    struct tm       timestamp;
 
     realtype        mf_tbl[12] = { 0.001308019, 0.001633298, 0.002131198, 0.002632776, 0.003031171, 0.003197325, 0.003095839, 0.002745240, 0.002260213, 0.001759481, 0.001373646, 0.001202083};
 
-    rawtime = (time_t *) malloc (sizeof (time_t));
-    *rawtime = (int) t;
-    timestamp = gmtime (rawtime);
+    rawtime = (int) t;
+    gmtime_r (&rawtime, &timestamp);
 
-    return (mf_tbl[timestamp->tm_mon]);
+    return (mf_tbl[timestamp.tm_mon]);
 }
 
 
@@ -98,20 +95,20 @@ realtype Interpolation (TSD * Data, realtype t)
     success = 0;
 
 //    t = t / (UNIT_C);
-    while (i < Data->length && t > Data->TS[i][0])
+    while (i < Data->length && t > Data->Time[i])
         i++;
     if (i == 0)
     {
         /* t is smaller than the 1st node */
-        result = Data->TS[i][1];
+        result = Data->TS[i][0];
     }
     else if (i >= Data->length)
     {
-        result = Data->TS[i - 1][1];
+        result = Data->TS[i - 1][0];
     }
     else
     {
-        result = ((Data->TS[i][0] - t) * Data->TS[i - 1][1] + (t - Data->TS[i - 1][0]) * Data->TS[i][1]) / (Data->TS[i][0] - Data->TS[i - 1][0]);
+        result = ((Data->Time[i] - t) * Data->TS[i - 1][0] + (t - Data->Time[i - 1]) * Data->TS[i][0]) / (Data->Time[i] - Data->Time[i - 1]);
         success = 1;
     }
     if (success == 0)
@@ -132,23 +129,23 @@ void MultiInterpolation (TSD * Data, realtype t, realtype *forcing, int num_forc
     success = 0;
 //
 //    t = t / (UNIT_C);
-    while (i < Data->length && t > Data->TS[i][0])
+    while (i < Data->length && t > Data->Time[i])
         i++;
     if (i == 0)
     {
         /* t is smaller than the 1st node */
         for (j = 0; j < num_forcing; j++)
-            forcing[j] = Data->TS[i][j + 1];
+            forcing[j] = Data->TS[i][j];
     }
     else if (i >= Data->length)
     {
         for (j = 0; j < num_forcing; j++)
-            forcing[j] = Data->TS[i-1][j + 1];
+            forcing[j] = Data->TS[i-1][j];
     }
     else
     {
         for (j = 0; j < num_forcing; j++)
-            forcing[j] = ((Data->TS[i][0] - t) * Data->TS[i - 1][j + 1] + (t - Data->TS[i - 1][0]) * Data->TS[i][j + 1]) / (Data->TS[i][0] - Data->TS[i - 1][0]);
+            forcing[j] = ((Data->Time[i] - t) * Data->TS[i - 1][j] + (t - Data->Time[i - 1]) * Data->TS[i][j]) / (Data->Time[i] - Data->Time[i - 1]);
         success = 1;
     }
     if (success == 0)
@@ -159,3 +156,36 @@ void MultiInterpolation (TSD * Data, realtype t, realtype *forcing, int num_forc
     }
 }
 
+
+/*
+ * Allocate the data of a time series. Times are kept in double in their
+ * own array; the values go in one time-major block of length x (numCol -
+ * 1) storetype entries (numCol includes the time column) and TS[j] points
+ * to record j in the block 
+ */
+void AllocTS (TSD * Data, int numCol)
+{
+    int             j;
+
+    Data->numCol = numCol;
+    Data->Time = (double *)malloc ((Data->length > 0 ? Data->length : 1) * sizeof (double));
+    Data->TS = (storetype **) malloc ((Data->length > 0 ? Data->length : 1) * sizeof (storetype *));
+    Data->TS[0] = (storetype *) malloc ((Data->length > 0 ? Data->length : 1) * (numCol - 1) * sizeof (storetype));
+    for (j = 1; j < Data->length; j++)
+        Data->TS[j] = Data->TS[0] + j * (numCol - 1);
+}
+
+void FreeTS (TSD * Data)
+{
+    free (Data->Time);
+    free (Data->TS[0]);
+    free (Data->TS);
+}
+
+/*
+ * Bytes held by the records of a time series 
+ */
+size_t SizeTS (const TSD * Data)
+{
+    return ((size_t)Data->length * (sizeof (double) + (Data->numCol - 1) * sizeof (storetype) + sizeof (storetype *)));
+}
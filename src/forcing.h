@@ -1,14 +1,26 @@
 #ifndef FORCING_HEADER
 #define FORCING_HEADER
 
+/*
+ * Storage type of forcing values and output accumulators. Arithmetic on
+ * them is always carried out in double 
+ */
+#ifdef _SINGLE_STORAGE_
+typedef float storetype;
+#else
+typedef double storetype;
+#endif
+
 typedef struct TSD_type
 {
     char            name[15];
     int             index;
     int             length;     /* length of time series */
+    int             numCol;     /* values per record, time included */
     int             iCounter;   /* interpolation counter */
     double          TSFactor;
-    double        **TS;         /* 2D time series data */
+    double         *Time;       /* time of each record */
+    storetype     **TS;         /* 2D time series data, time excluded */
 } TSD;
 
 double monthly_lai (double t, int LC_type);
@@ -16,6 +28,9 @@ double monthly_rl (double t, int LC_type);
 double monthly_mf (double t);
 double Interpolation (TSD * Data, double t);
 void MultiInterpolation (TSD * Data, double t, double *forcing, int num_forcing);
+void AllocTS (TSD * Data, int numCol);
+void FreeTS (TSD * Data);
+size_t SizeTS (const TSD * Data);
 void        update (double, void *);
 
 #endif
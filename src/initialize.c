@@ -39,6 +39,277 @@ realtype FieldCapacity (realtype Alpha, realtype Beta, realtype Kv, realtype The
     return ThetaRef;
 }
 
+/*
+ * Renumber river segments so that every segment is stored before its down
+ * stream segment (Kahn's algorithm, ties broken by the order of the .riv
+ * file). RivLoc maps each segment of the .riv file to its new position;
+ * Riv[].index keeps the original ID 
+ */
+static void SortRiver (Model_Data DS, int topoOrder)
+{
+    int             i, k, head, tail;
+    int            *numUp, *queue;
+    river_segment  *riv;
+
+    DS->RivLoc = (int *)malloc (DS->NumRiv * sizeof (int));
+    for (i = 0; i < DS->NumRiv; i++)
+        DS->RivLoc[i] = i;
+    if (topoOrder == 0)
+        return;
+
+    numUp = (int *)calloc (DS->NumRiv, sizeof (int));
+    queue = (int *)malloc (DS->NumRiv * sizeof (int));
+    for (i = 0; i < DS->NumRiv; i++)
+        if (DS->Riv[i].down > 0)
+            numUp[DS->Riv[i].down - 1]++;
+    tail = 0;
+    for (i = 0; i < DS->NumRiv; i++)
+        if (numUp[i] == 0)
+            queue[tail++] = i;
+    for (head = 0; head < tail; head++)
+    {
+        k = DS->Riv[queue[head]].down - 1;
+        if (k >= 0 && --numUp[k] == 0)
+            queue[tail++] = k;
+    }
+    if (tail < DS->NumRiv)
+    {
+        printf ("\n  Fatal Error: river network contains a loop!\n");
+        exit (1);
+    }
+
+    riv = (river_segment *) malloc (DS->NumRiv * sizeof (river_segment));
+    for (k = 0; k < DS->NumRiv; k++)
+    {
+        riv[k] = DS->Riv[queue[k]];
+        DS->RivLoc[queue[k]] = k;
+    }
+    for (k = 0; k < DS->NumRiv; k++)
+        if (riv[k].down > 0)
+            riv[k].down = DS->RivLoc[riv[k].down - 1] + 1;
+    free (DS->Riv);
+    DS->Riv = riv;
+
+    free (numUp);
+    free (queue);
+}
+
+/*
+ * Renumber elements by reverse Cuthill-McKee over the neighbour graph, so
+ * that neighbours are stored close to each other and the Jacobian has a
+ * narrow band. Each connected part starts from its element of lowest
+ * degree. EleLoc maps each element of the .mesh file to its new position;
+ * Ele[].index keeps the original ID 
+ */
+static void SortMesh (Model_Data DS, int eleOrder)
+{
+    int             i, j, k, n, head, tail;
+    int             nb[3];
+    int            *deg, *queue;
+    element        *ele;
+    element_IC     *ele_IC;
+
+    DS->EleLoc = (int *)malloc (DS->NumEle * sizeof (int));
+    for (i = 0; i < DS->NumEle; i++)
+        DS->EleLoc[i] = i;
+    if (eleOrder == 0)
+        return;
+
+    deg = (int *)calloc (DS->NumEle, sizeof (int));
+    queue = (int *)malloc (DS->NumEle * sizeof (int));
+    for (i = 0; i < DS->NumEle; i++)
+    {
+        for (j = 0; j < 3; j++)
+            if (DS->Ele[i].nabr[j] > 0)
+                deg[i]++;
+        DS->EleLoc[i] = -1;
+    }
+
+    tail = 0;
+    head = 0;
+    while (tail < DS->NumEle)
+    {
+        k = -1;
+        for (i = 0; i < DS->NumEle; i++)
+            if (DS->EleLoc[i] < 0 && (k < 0 || deg[i] < deg[k]))
+                k = i;
+        DS->EleLoc[k] = tail;
+        queue[tail++] = k;
+        for (; head < tail; head++)
+        {
+            /* Unvisited neighbours in increasing degree */
+            n = 0;
+            for (j = 0; j < 3; j++)
+            {
+                k = DS->Ele[queue[head]].nabr[j] - 1;
+                if (k >= 0 && DS->EleLoc[k] < 0)
+                {
+                    for (i = n; i > 0 && deg[nb[i - 1]] > deg[k]; i--)
+                        nb[i] = nb[i - 1];
+                    nb[i] = k;
+                    n++;
+                    DS->EleLoc[k] = tail;
+                }
+            }
+            for (i = 0; i < n; i++)
+                queue[tail++] = nb[i];
+        }
+    }
+
+    ele = (element *) malloc (DS->NumEle * sizeof (element));
+    ele_IC = (element_IC *) malloc (DS->NumEle * sizeof (element_IC));
+    for (k = 0; k < DS->NumEle; k++)
+    {
+        i = queue[DS->NumEle - 1 - k];
+        DS->EleLoc[i] = k;
+        ele[k] = DS->Ele[i];
+        ele_IC[k] = DS->Ele_IC[i];
+    }
+    for (k = 0; k < DS->NumEle; k++)
+    {
+        DS->Ele[k] = ele[k];
+        DS->Ele_IC[k] = ele_IC[k];
+        for (j = 0; j < 3; j++)
+            if (DS->Ele[k].nabr[j] > 0)
+                DS->Ele[k].nabr[j] = DS->EleLoc[DS->Ele[k].nabr[j] - 1] + 1;
+    }
+    for (i = 0; i < DS->NumRiv; i++)
+    {
+        DS->Riv[i].LeftEle = DS->EleLoc[DS->Riv[i].LeftEle - 1] + 1;
+        DS->Riv[i].RightEle = DS->EleLoc[DS->Riv[i].RightEle - 1] + 1;
+    }
+
+    free (ele);
+    free (ele_IC);
+    free (deg);
+    free (queue);
+}
+
+#ifdef _OPENMP
+/*
+ * Move an array of records to a new block. The records are split into
+ * segments (e.g. elements, then river segments), and each segment is
+ * shared among threads by the static schedule the loops of f () get by
+ * default. Each thread makes the first write to its own share, so the
+ * pages of the share are placed in the memory local to that thread 
+ */
+static void *PlaceArray (void *src, size_t size, int numSeg, const int *segLen)
+{
+    char           *dst;
+    size_t          offset;
+    int             i, k, n;
+
+    n = 0;
+    for (k = 0; k < numSeg; k++)
+        n += segLen[k];
+    dst = (char *)malloc ((n > 0 ? n : 1) * size);
+
+    offset = 0;
+    for (k = 0; k < numSeg; k++)
+    {
+#pragma omp parallel for schedule (static)
+        for (i = 0; i < segLen[k]; i++)
+            memcpy (dst + (offset + i) * size, (char *)src + (offset + i) * size, size);
+        offset += segLen[k];
+    }
+
+    free (src);
+    return (dst);
+}
+
+/*
+ * First-touch placement of the arrays swept by f () and the ET step.
+ * Forcing time series are indexed by time and shared by all elements, so
+ * they are left where they are 
+ */
+static void PlaceArrays (Model_Data DS, N_Vector CV_Y)
+{
+    int             ele[1], riv[1], eleriv[2], state[5];
+    int             i;
+
+    ele[0] = DS->NumEle;
+    riv[0] = DS->NumRiv;
+    eleriv[0] = DS->NumEle;
+    eleriv[1] = DS->NumRiv;
+    state[0] = state[1] = state[2] = DS->NumEle;
+    state[3] = state[4] = DS->NumRiv;
+
+    DS->Ele = (element *) PlaceArray (DS->Ele, sizeof (element), 2, eleriv);
+    DS->Riv = (river_segment *) PlaceArray (DS->Riv, sizeof (river_segment), 1, riv);
+
+    /* Flux blocks are moved a row at a time */
+    DS->FluxSurf[0] = (realtype *) PlaceArray (DS->FluxSurf[0], 3 * sizeof (realtype), 1, ele);
+    DS->FluxSub[0] = (realtype *) PlaceArray (DS->FluxSub[0], 3 * sizeof (realtype), 1, ele);
+    DS->EleET[0] = (realtype *) PlaceArray (DS->EleET[0], 3 * sizeof (realtype), 1, ele);
+    DS->FluxRiv[0] = (realtype *) PlaceArray (DS->FluxRiv[0], 11 * sizeof (realtype), 1, riv);
+    DS->JvFluxSurf[0] = (realtype *) PlaceArray (DS->JvFluxSurf[0], 3 * sizeof (realtype), 1, ele);
+    DS->JvFluxSub[0] = (realtype *) PlaceArray (DS->JvFluxSub[0], 3 * sizeof (realtype), 1, ele);
+    DS->JvFluxRiv[0] = (realtype *) PlaceArray (DS->JvFluxRiv[0], 11 * sizeof (realtype), 1, riv);
+    for (i = 0; i < DS->NumEle; i++)
+    {
+        DS->FluxSurf[i] = DS->FluxSurf[0] + 3 * i;
+        DS->FluxSub[i] = DS->FluxSub[0] + 3 * i;
+        DS->EleET[i] = DS->EleET[0] + 3 * i;
+        DS->JvFluxSurf[i] = DS->JvFluxSurf[0] + 3 * i;
+        DS->JvFluxSub[i] = DS->JvFluxSub[0] + 3 * i;
+    }
+    for (i = 0; i < DS->NumRiv; i++)
+    {
+        DS->FluxRiv[i] = DS->FluxRiv[0] + 11 * i;
+        DS->JvFluxRiv[i] = DS->JvFluxRiv[0] + 11 * i;
+    }
+
+    DS->EleSurf = (realtype *) PlaceArray (DS->EleSurf, sizeof (realtype), 2, eleriv);
+    DS->EleGW = (realtype *) PlaceArray (DS->EleGW, sizeof (realtype), 2, eleriv);
+    DS->EleUnsat = (realtype *) PlaceArray (DS->EleUnsat, sizeof (realtype), 1, ele);
+    DS->RivStg = (realtype *) PlaceArray (DS->RivStg, sizeof (realtype), 1, riv);
+#ifdef _FLUX_PIHM_
+    DS->SfcSat = (realtype *) PlaceArray (DS->SfcSat, sizeof (realtype), 1, ele);
+    DS->EleETsat = (realtype *) PlaceArray (DS->EleETsat, sizeof (realtype), 1, ele);
+    DS->EleFCR = (realtype *) PlaceArray (DS->EleFCR, sizeof (realtype), 1, ele);
+#endif
+    DS->ElePrep = (realtype *) PlaceArray (DS->ElePrep, sizeof (realtype), 1, ele);
+    DS->EleNetPrep = (realtype *) PlaceArray (DS->EleNetPrep, sizeof (realtype), 1, ele);
+    DS->EleViR = (realtype *) PlaceArray (DS->EleViR, sizeof (realtype), 1, ele);
+    DS->Recharge = (realtype *) PlaceArray (DS->Recharge, sizeof (realtype), 1, ele);
+    DS->JvEleViR = (realtype *) PlaceArray (DS->JvEleViR, sizeof (realtype), 1, ele);
+    DS->JvRecharge = (realtype *) PlaceArray (DS->JvRecharge, sizeof (realtype), 1, ele);
+    DS->EleIS = (realtype *) PlaceArray (DS->EleIS, sizeof (realtype), 1, ele);
+    DS->EleISmax = (realtype *) PlaceArray (DS->EleISmax, sizeof (realtype), 1, ele);
+    DS->EleISsnowmax = (realtype *) PlaceArray (DS->EleISsnowmax, sizeof (realtype), 1, ele);
+    DS->EleSnow = (realtype *) PlaceArray (DS->EleSnow, sizeof (realtype), 1, ele);
+    DS->EleSnowGrnd = (realtype *) PlaceArray (DS->EleSnowGrnd, sizeof (realtype), 1, ele);
+    DS->EleSnowCanopy = (realtype *) PlaceArray (DS->EleSnowCanopy, sizeof (realtype), 1, ele);
+    DS->EleTF = (realtype *) PlaceArray (DS->EleTF, sizeof (realtype), 1, ele);
+
+    DS->EleArea = (realtype *) PlaceArray (DS->EleArea, sizeof (realtype), 1, ele);
+    DS->EleZmin = (realtype *) PlaceArray (DS->EleZmin, sizeof (realtype), 2, eleriv);
+    DS->EleZmax = (realtype *) PlaceArray (DS->EleZmax, sizeof (realtype), 2, eleriv);
+    DS->EleKsatH = (realtype *) PlaceArray (DS->EleKsatH, sizeof (realtype), 2, eleriv);
+    DS->EleKsatV = (realtype *) PlaceArray (DS->EleKsatV, sizeof (realtype), 1, ele);
+    DS->ElePorosity = (realtype *) PlaceArray (DS->ElePorosity, sizeof (realtype), 2, eleriv);
+    DS->EleAlpha = (realtype *) PlaceArray (DS->EleAlpha, sizeof (realtype), 1, ele);
+    DS->EleBeta = (realtype *) PlaceArray (DS->EleBeta, sizeof (realtype), 1, ele);
+    DS->EleNabr = (int *)PlaceArray (DS->EleNabr, 3 * sizeof (int), 1, ele);
+    DS->EleEffKH = (realtype *) PlaceArray (DS->EleEffKH, sizeof (realtype), 1, ele);
+    DS->EleSlope = (realtype *) PlaceArray (DS->EleSlope, sizeof (realtype), 1, ele);
+    DS->RivEffKH = (realtype *) PlaceArray (DS->RivEffKH, sizeof (realtype), 1, riv);
+    DS->RivArea = (realtype *) PlaceArray (DS->RivArea, sizeof (realtype), 1, riv);
+    DS->RivPerem = (realtype *) PlaceArray (DS->RivPerem, sizeof (realtype), 1, riv);
+
+    /* Edge lists are swept by edge */
+    DS->IntrEdge = (int *)PlaceArray (DS->IntrEdge, sizeof (int), 1, &DS->NumIntrEdge);
+    DS->RivEdge = (int *)PlaceArray (DS->RivEdge, sizeof (int), 1, &DS->NumRivEdge);
+    DS->NoFlowEdge = (int *)PlaceArray (DS->NoFlowEdge, sizeof (int), 1, &DS->NumNoFlowEdge);
+    DS->DiriEdge = (int *)PlaceArray (DS->DiriEdge, sizeof (int), 1, &DS->NumDiriEdge);
+    DS->NeumEdge = (int *)PlaceArray (DS->NeumEdge, sizeof (int), 1, &DS->NumNeumEdge);
+
+    /* State vector and its non-negative copy */
+    DS->DummyY = (realtype *) PlaceArray (DS->DummyY, sizeof (realtype), 5, state);
+    NV_DATA_S (CV_Y) = (realtype *) PlaceArray (NV_DATA_S (CV_Y), sizeof (realtype), 5, state);
+}
+#endif
+
 void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *outputdir)
 {
     FILE           *Ofile;
@@ -62,7 +333,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumEle + DS->NumRiv;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleGW[i]);
+            CS->PCtrl[icounter].PrintVar[i] = (i < DS->NumEle) ? &(DS->EleGW[DS->EleLoc[i]]) : &(DS->EleGW[DS->NumEle + DS->RivLoc[i - DS->NumEle]]);
         icounter++;
     }
     if (CS->PrintSurf > 0)
@@ -72,7 +343,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumEle;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleSurf[i]);
+            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleSurf[DS->EleLoc[i]]);
         icounter++;
     }
     if (CS->PrintSnow > 0)
@@ -82,7 +353,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumEle;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleSnow[i]);
+            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleSnow[DS->EleLoc[i]]);
         icounter++;
     }
 
@@ -105,7 +376,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumRiv;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->RivStg[i]);
+            CS->PCtrl[icounter].PrintVar[i] = &(DS->RivStg[DS->RivLoc[i]]);
         icounter++;
     }
     if (CS->PrintRech > 0)
@@ -115,7 +386,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumEle;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->Recharge[i]);
+            CS->PCtrl[icounter].PrintVar[i] = &(DS->Recharge[DS->EleLoc[i]]);
         icounter++;
     }
     if (CS->PrintIS > 0)
@@ -125,7 +396,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumEle;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleIS[i]);
+            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleIS[DS->EleLoc[i]]);
         icounter++;
     }
     if (CS->PrintUnsat > 0)
@@ -135,7 +406,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
         CS->PCtrl[icounter].NumVar = DS->NumEle;
         CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
         for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleUnsat[i]);
+            CS->PCtrl[icounter].PrintVar[i] = &(DS->EleUnsat[DS->EleLoc[i]]);
         icounter++;
     }
     for (j = 0; j < 3; j++)
@@ -148,7 +419,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
             CS->PCtrl[icounter].NumVar = DS->NumEle;
             CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
             for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-                CS->PCtrl[icounter].PrintVar[i] = &(DS->EleET[i][j]);
+                CS->PCtrl[icounter].PrintVar[i] = &(DS->EleET[DS->EleLoc[i]][j]);
             icounter++;
         }
     }
@@ -162,7 +433,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
             CS->PCtrl[icounter].NumVar = DS->NumRiv;
             CS->PCtrl[icounter].PrintVar = (realtype **) malloc (CS->PCtrl[icounter].NumVar * sizeof (realtype *));
             for (i = 0; i < CS->PCtrl[icounter].NumVar; i++)
-                CS->PCtrl[icounter].PrintVar[i] = &(DS->FluxRiv[i][j]);
+                CS->PCtrl[icounter].PrintVar[i] = &(DS->FluxRiv[DS->RivLoc[i]][j]);
             icounter++;
         }
     }
@@ -173,7 +444,7 @@ void initialize_output (char *filename, Model_Data DS, Control_Data * CS, char *
     {
         Ofile = fopen (CS->PCtrl[i].name, "w");
         fclose (Ofile);
-        CS->PCtrl[i].buffer = (realtype *) calloc (CS->PCtrl[i].NumVar, sizeof (realtype));
+        CS->PCtrl[i].buffer = (storetype *) calloc (CS->PCtrl[i].NumVar, sizeof (storetype));
     }
 }
 
@@ -196,12 +467,26 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
         printf ("\n\nInitializing data structure\n");
 
     /*
-     * allocate memory storage to flux terms 
+     * allocate memory storage to flux terms. Each flux is one contiguous
+     * block with a fixed number of entries per element or segment; the
+     * row pointers index into the block, and row 0 owns it 
      */
     DS->FluxSurf = (realtype **) malloc (DS->NumEle * sizeof (realtype *));
     DS->FluxSub = (realtype **) malloc (DS->NumEle * sizeof (realtype *));
-    DS->FluxRiv = (realtype **) malloc (DS->NumRiv * sizeof (realtype *));
+    DS->FluxRiv = (realtype **) malloc ((DS->NumRiv > 0 ? DS->NumRiv : 1) * sizeof (realtype *));
     DS->EleET = (realtype **) malloc (DS->NumEle * sizeof (realtype *));
+    DS->FluxSurf[0] = (realtype *) malloc (3 * DS->NumEle * sizeof (realtype));
+    DS->FluxSub[0] = (realtype *) malloc (3 * DS->NumEle * sizeof (realtype));
+    DS->FluxRiv[0] = (realtype *) malloc ((DS->NumRiv > 0 ? 11 * DS->NumRiv : 1) * sizeof (realtype));
+    DS->EleET[0] = (realtype *) calloc (3 * DS->NumEle, sizeof (realtype));
+    for (i = 0; i < DS->NumEle; i++)
+    {
+        DS->FluxSurf[i] = DS->FluxSurf[0] + 3 * i;
+        DS->FluxSub[i] = DS->FluxSub[0] + 3 * i;
+        DS->EleET[i] = DS->EleET[0] + 3 * i;
+    }
+    for (i = 0; i < DS->NumRiv; i++)
+        DS->FluxRiv[i] = DS->FluxRiv[0] + 11 * i;
     DS->Albedo = (realtype *) malloc (DS->NumEle * sizeof (realtype));  /* Expanded by Y. Shi */
     DS->RivStg = (realtype *) malloc (DS->NumRiv * sizeof (realtype));
     DS->EleSurf = (realtype *) malloc ((DS->NumEle + DS->NumRiv) * sizeof (realtype));
@@ -226,6 +511,11 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
     DS->EleTF = (realtype *) malloc (DS->NumEle * sizeof (realtype));
     //  DS->EleETloss = (realtype *)malloc(DS->NumEle*sizeof(realtype));
     DS->EleNetPrep = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->EleEffKH = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->EleSlope = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->RivEffKH = (realtype *) malloc (DS->NumRiv * sizeof (realtype));
+    DS->RivArea = (realtype *) malloc (DS->NumRiv * sizeof (realtype));
+    DS->RivPerem = (realtype *) malloc (DS->NumRiv * sizeof (realtype));
 
     for (i = 0; i < DS->NumSoil; i++)
     {
@@ -236,11 +526,29 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
         DS->Soil[i].ThetaRef = FieldCapacity (DS->Soil[i].Alpha, DS->Soil[i].Beta, DS->Geol[i].KsatV, DS->Soil[i].ThetaS, DS->Soil[i].ThetaR) + DS->Soil[i].ThetaR;
     }
 
+    /*
+     * Tabulate van Genuchten functions of each soil type (after
+     * calibration) over the saturation range used in f () 
+     */
+    DS->VGTbl = (vg_table *) malloc (DS->NumSoil * sizeof (vg_table));
+    for (i = 0; i < DS->NumSoil; i++)
+        InitVGTable (&DS->VGTbl[i], CS->Cal.Beta * DS->Soil[i].Beta, multF * EPS, CS->VGTableTol);
+
+    /*
+     * Tabulate cross sections of each river shape (after calibration) up
+     * to twice the bankfull depth 
+     */
+    DS->RivTbl = (riv_table *) malloc (DS->NumRivShape * sizeof (riv_table));
+    for (i = 0; i < DS->NumRivShape; i++)
+        InitRivTable (&DS->RivTbl[i], DS->Riv_Shape[i].interpOrd, CS->Cal.rivShapeCoeff * DS->Riv_Shape[i].coeff, 2 * CS->Cal.rivDepth * DS->Riv_Shape[i].depth, CS->RivTableTol);
+
+    /*
+     * Elements are renumbered before any element property is computed 
+     */
+    SortMesh (DS, CS->EleOrder);
+
     for (i = 0; i < DS->NumEle; i++)
     {
-        DS->FluxSurf[i] = (realtype *) malloc (3 * sizeof (realtype));
-        DS->FluxSub[i] = (realtype *) malloc (3 * sizeof (realtype));
-        DS->EleET[i] = (realtype *) calloc (3, sizeof (realtype));
         a_x = DS->Node[DS->Ele[i].node[0] - 1].x;
         b_x = DS->Node[DS->Ele[i].node[1] - 1].x;
         c_x = DS->Node[DS->Ele[i].node[2] - 1].x;
@@ -331,18 +639,30 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
         DS->Ele[i].windH = DS->windH[DS->Ele[i].meteo - 1];
     }
 
+    /*
+     * River segments are renumbered before any river index is stored 
+     */
+    SortRiver (DS, CS->RivTopoOrder);
+
     for (i = 0; i < DS->NumRiv; i++)
     {
-        DS->FluxRiv[i] = (realtype *) malloc (11 * sizeof (realtype));
+        DS->Riv[i].leftEdge = -1;
+        DS->Riv[i].rightEdge = -1;
         for (j = 0; j < 3; j++)
         {
             /*
              * Note: Strategy to use BC < -4 for river identification 
              */
             if (DS->Ele[DS->Riv[i].LeftEle - 1].nabr[j] == DS->Riv[i].RightEle)
+            {
                 DS->Ele[DS->Riv[i].LeftEle - 1].BC[j] = -4 * (i + 1);
+                DS->Riv[i].leftEdge = j;
+            }
             if (DS->Ele[DS->Riv[i].RightEle - 1].nabr[j] == DS->Riv[i].LeftEle)
+            {
                 DS->Ele[DS->Riv[i].RightEle - 1].BC[j] = -4 * (i + 1);
+                DS->Riv[i].rightEdge = j;
+            }
         }
         DS->Riv[i].x = (DS->Node[DS->Riv[i].FromNode - 1].x + DS->Node[DS->Riv[i].ToNode - 1].x) / 2;
         DS->Riv[i].y = (DS->Node[DS->Riv[i].FromNode - 1].y + DS->Node[DS->Riv[i].ToNode - 1].y) / 2;
@@ -367,12 +687,93 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
         DS->Ele[i + DS->NumEle].Porosity = 0.5 * (DS->Ele[DS->Riv[i].LeftEle - 1].Porosity + DS->Ele[DS->Riv[i].RightEle - 1].Porosity);
     }
 
+    /*
+     * Distances and bankfull widths used by the flux calculation never
+     * change during the simulation 
+     */
+    for (i = 0; i < DS->NumEle; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            if (DS->Ele[i].nabr[j] > 0)
+                DS->Ele[i].dist[j] = sqrt (pow ((DS->Ele[i].x - DS->Ele[DS->Ele[i].nabr[j] - 1].x), 2) + pow ((DS->Ele[i].y - DS->Ele[DS->Ele[i].nabr[j] - 1].y), 2));
+            else
+                /*
+                 * Minimum Distance from circumcenter to the edge of the triangle on which BDD. condition is defined
+                 */
+                DS->Ele[i].dist[j] = sqrt (pow (DS->Ele[i].edge[0] * DS->Ele[i].edge[1] * DS->Ele[i].edge[2] / (4 * DS->Ele[i].area), 2) - pow (DS->Ele[i].edge[j] / 2, 2));
+        }
+    }
+
+    /*
+     * Classify element edges, so that f () loops over edges of one type at
+     * a time 
+     */
+    DS->IntrEdge = (int *)malloc (3 * DS->NumEle * sizeof (int));
+    DS->RivEdge = (int *)malloc (3 * DS->NumEle * sizeof (int));
+    DS->NoFlowEdge = (int *)malloc (3 * DS->NumEle * sizeof (int));
+    DS->DiriEdge = (int *)malloc (3 * DS->NumEle * sizeof (int));
+    DS->NeumEdge = (int *)malloc (3 * DS->NumEle * sizeof (int));
+    DS->NumIntrEdge = 0;
+    DS->NumRivEdge = 0;
+    DS->NumNoFlowEdge = 0;
+    DS->NumDiriEdge = 0;
+    DS->NumNeumEdge = 0;
+    for (i = 0; i < DS->NumEle; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            if (DS->Ele[i].nabr[j] > 0)
+            {
+                if (DS->Ele[i].BC[j] > -4)
+                    DS->IntrEdge[DS->NumIntrEdge++] = 3 * i + j;
+                else
+                    DS->RivEdge[DS->NumRivEdge++] = 3 * i + j;
+            }
+            else if (DS->Ele[i].BC[j] == 0)
+                DS->NoFlowEdge[DS->NumNoFlowEdge++] = 3 * i + j;
+            else if (DS->Ele[i].BC[j] == 1)
+                DS->DiriEdge[DS->NumDiriEdge++] = 3 * i + j;
+            else
+                DS->NeumEdge[DS->NumNeumEdge++] = 3 * i + j;
+        }
+    }
+
+    for (i = 0; i < DS->NumRiv; i++)
+    {
+        DS->Riv[i].bankWid = CS_Width (DS->Riv_Shape[DS->Riv[i].shape - 1].interpOrd, DS->Riv[i].depth, DS->Riv[i].coeff);
+        DS->Riv[i].distDown = (DS->Riv[i].down > 0) ? 0.5 * (DS->Riv[i].Length + DS->Riv[DS->Riv[i].down - 1].Length) : 0;
+        DS->Riv[i].distOut = sqrt (pow (DS->Riv[i].x - DS->Node[DS->Riv[i].ToNode - 1].x, 2) + pow (DS->Riv[i].y - DS->Node[DS->Riv[i].ToNode - 1].y, 2));
+        DS->Riv[i].distLeft = sqrt (pow ((DS->Riv[i].x - DS->Ele[DS->Riv[i].LeftEle - 1].x), 2) + pow ((DS->Riv[i].y - DS->Ele[DS->Riv[i].LeftEle - 1].y), 2));
+        DS->Riv[i].distRight = sqrt (pow ((DS->Riv[i].x - DS->Ele[DS->Riv[i].RightEle - 1].x), 2) + pow ((DS->Riv[i].y - DS->Ele[DS->Riv[i].RightEle - 1].y), 2));
+        DS->Riv[i].numUp = 0;
+    }
+
+    /*
+     * Up stream segments of each river segment, so that in-flow can be
+     * gathered rather than scattered to the down stream segment 
+     */
+    for (i = 0; i < DS->NumRiv; i++)
+        if (DS->Riv[i].down > 0)
+            DS->Riv[DS->Riv[i].down - 1].numUp++;
+    for (i = 0; i < DS->NumRiv; i++)
+    {
+        DS->Riv[i].up = (int *)malloc ((DS->Riv[i].numUp > 0 ? DS->Riv[i].numUp : 1) * sizeof (int));
+        DS->Riv[i].numUp = 0;
+    }
+    for (i = 0; i < DS->NumRiv; i++)
+        if (DS->Riv[i].down > 0)
+        {
+            k = DS->Riv[i].down - 1;
+            DS->Riv[k].up[DS->Riv[k].numUp++] = i + 1;
+        }
+
     for (i = 0; i < DS->NumTS; i++)
     {
         for (j = 0; j < DS->TSD_meteo[i].length; j++)
         {
-            DS->TSD_meteo[i].TS[j][PRCP_TS + 1] = CS->Cal.Prep * DS->TSD_meteo[i].TS[j][PRCP_TS + 1];
-            DS->TSD_meteo[i].TS[j][SFCTMP_TS + 1] = CS->Cal.Temp * DS->TSD_meteo[i].TS[j][SFCTMP_TS + 1];
+            DS->TSD_meteo[i].TS[j][PRCP_TS] = CS->Cal.Prep * DS->TSD_meteo[i].TS[j][PRCP_TS];
+            DS->TSD_meteo[i].TS[j][SFCTMP_TS] = CS->Cal.Temp * DS->TSD_meteo[i].TS[j][SFCTMP_TS];
         }
     }
 
@@ -398,7 +799,7 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
             }
             if (tmpBool == 1)
             {
-                printf ("\n Ele %d is sink ", i + 1);
+                printf ("\n Ele %d is sink ", DS->Ele[i].index);
                 /*
                  * Note: Following correction is being applied for debug==1 case only 
                  */
@@ -444,7 +845,7 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
                 }
                 if (tmpBool == 1)
                 {
-                    printf ("\n Ele %d is sink ", i + 1);
+                    printf ("\n Ele %d is sink ", DS->Ele[i].index);
                     /*
                      * Note: Following correction is being applied for debug==1 case only 
                      */
@@ -475,7 +876,7 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
                 {
                     BoolR = 1;
                     printf ("\n Riv %d is lower than downstream Riv %d",
-                       i + 1, DS->Riv[i].down);
+                       DS->Riv[i].index, DS->Riv[DS->Riv[i].down - 1].index);
                 }
             }
         }
@@ -612,8 +1013,10 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
         }
         else
         {
-            for (i = 0; i < DS->NumEle; i++)
+            for (j = 0; j < DS->NumEle; j++)
             {
+                /* Elements are stored in the order of the .mesh file */
+                i = DS->EleLoc[j];
                 fscanf (init_file, "%lf %lf %lf %lf %lf", &DS->EleIS[i], &DS->EleSnow[i], &tempvalue1, &tempvalue2, &tempvalue3);
                 NV_Ith_S (CV_Y, i) = tempvalue1;
                 NV_Ith_S (CV_Y, i + DS->NumEle) = tempvalue2;
@@ -622,8 +1025,10 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
                 DS->EleUnsat[i] = tempvalue2;
                 DS->EleGW[i] = tempvalue3;
             }
-            for (i = 0; i < DS->NumRiv; i++)
+            for (j = 0; j < DS->NumRiv; j++)
             {
+                /* Rivers are stored in the order of the .riv file */
+                i = DS->RivLoc[j];
                 fscanf (init_file, "%lf %lf", &tempvalue1, &tempvalue2);
                 NV_Ith_S (CV_Y, i + 3 * DS->NumEle) = tempvalue1;
                 NV_Ith_S (CV_Y, i + 3 * DS->NumEle + DS->NumRiv) = tempvalue2;
@@ -633,4 +1038,87 @@ void initialize (char *filename, Model_Data DS, Control_Data * CS, N_Vector CV_Y
         }
         fclose (init_file);
     }
+
+    /*
+     * Array copies of the element fields used by f () 
+     */
+    DS->EleArea = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->EleZmin = (realtype *) malloc ((DS->NumEle + DS->NumRiv) * sizeof (realtype));
+    DS->EleZmax = (realtype *) malloc ((DS->NumEle + DS->NumRiv) * sizeof (realtype));
+    DS->EleKsatH = (realtype *) malloc ((DS->NumEle + DS->NumRiv) * sizeof (realtype));
+    DS->EleKsatV = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->ElePorosity = (realtype *) malloc ((DS->NumEle + DS->NumRiv) * sizeof (realtype));
+    DS->EleAlpha = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->EleBeta = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->EleNabr = (int *)malloc (3 * DS->NumEle * sizeof (int));
+    for (i = 0; i < DS->NumEle + DS->NumRiv; i++)
+    {
+        DS->EleZmin[i] = DS->Ele[i].zmin;
+        DS->EleZmax[i] = DS->Ele[i].zmax;
+        DS->EleKsatH[i] = DS->Ele[i].KsatH;
+        DS->ElePorosity[i] = DS->Ele[i].Porosity;
+        if (i < DS->NumEle)
+        {
+            DS->EleArea[i] = DS->Ele[i].area;
+            DS->EleKsatV[i] = DS->Ele[i].KsatV;
+            DS->EleAlpha[i] = DS->Ele[i].Alpha;
+            DS->EleBeta[i] = DS->Ele[i].Beta;
+            for (j = 0; j < 3; j++)
+                DS->EleNabr[3 * i + j] = DS->Ele[i].nabr[j];
+        }
+    }
+
+    /*
+     * Lean memory mode: initial conditions and albedo are not used after
+     * this point, and edge lists only need their actual length 
+     */
+    if (CS->LeanMem)
+    {
+        free (DS->Ele_IC);
+        free (DS->Riv_IC);
+        free (DS->Albedo);
+        DS->Ele_IC = NULL;
+        DS->Riv_IC = NULL;
+        DS->Albedo = NULL;
+        DS->IntrEdge = (int *)realloc (DS->IntrEdge, (DS->NumIntrEdge > 0 ? DS->NumIntrEdge : 1) * sizeof (int));
+        DS->RivEdge = (int *)realloc (DS->RivEdge, (DS->NumRivEdge > 0 ? DS->NumRivEdge : 1) * sizeof (int));
+        DS->NoFlowEdge = (int *)realloc (DS->NoFlowEdge, (DS->NumNoFlowEdge > 0 ? DS->NumNoFlowEdge : 1) * sizeof (int));
+        DS->DiriEdge = (int *)realloc (DS->DiriEdge, (DS->NumDiriEdge > 0 ? DS->NumDiriEdge : 1) * sizeof (int));
+        DS->NeumEdge = (int *)realloc (DS->NeumEdge, (DS->NumNeumEdge > 0 ? DS->NumNeumEdge : 1) * sizeof (int));
+    }
+
+    /*
+     * Flux arrays of the perturbed RHS calls start as copies, so that
+     * entries no RHS call writes agree in both sets 
+     */
+    DS->JvFluxSurf = (realtype **) malloc (DS->NumEle * sizeof (realtype *));
+    DS->JvFluxSub = (realtype **) malloc (DS->NumEle * sizeof (realtype *));
+    DS->JvFluxRiv = (realtype **) malloc ((DS->NumRiv > 0 ? DS->NumRiv : 1) * sizeof (realtype *));
+    DS->JvFluxSurf[0] = (realtype *) malloc (3 * DS->NumEle * sizeof (realtype));
+    DS->JvFluxSub[0] = (realtype *) malloc (3 * DS->NumEle * sizeof (realtype));
+    DS->JvFluxRiv[0] = (realtype *) malloc ((DS->NumRiv > 0 ? 11 * DS->NumRiv : 1) * sizeof (realtype));
+    memcpy (DS->JvFluxSurf[0], DS->FluxSurf[0], 3 * DS->NumEle * sizeof (realtype));
+    memcpy (DS->JvFluxSub[0], DS->FluxSub[0], 3 * DS->NumEle * sizeof (realtype));
+    memcpy (DS->JvFluxRiv[0], DS->FluxRiv[0], 11 * DS->NumRiv * sizeof (realtype));
+    for (i = 0; i < DS->NumEle; i++)
+    {
+        DS->JvFluxSurf[i] = DS->JvFluxSurf[0] + 3 * i;
+        DS->JvFluxSub[i] = DS->JvFluxSub[0] + 3 * i;
+    }
+    for (i = 0; i < DS->NumRiv; i++)
+        DS->JvFluxRiv[i] = DS->JvFluxRiv[0] + 11 * i;
+    DS->JvEleViR = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    DS->JvRecharge = (realtype *) malloc (DS->NumEle * sizeof (realtype));
+    memcpy (DS->JvEleViR, DS->EleViR, DS->NumEle * sizeof (realtype));
+    memcpy (DS->JvRecharge, DS->Recharge, DS->NumEle * sizeof (realtype));
+
+#ifdef _OPENMP
+    if (CS->FirstTouch)
+        PlaceArrays (DS, CV_Y);
+#endif
+
+    /* Temporary state variables are read by is_sm_et before the first call
+     * to f */
+    for (i = 0; i < 3 * DS->NumEle + 2 * DS->NumRiv; i++)
+        DS->DummyY[i] = (NV_Ith_S (CV_Y, i) >= 0) ? NV_Ith_S (CV_Y, i) : 0;
 }
@@ -48,7 +48,7 @@ void is_sm_et(realtype t, realtype stepsize, void *DS, N_Vector VY)
 	realtype        isval = 0, etval = 0;
 	realtype        fracSnow, snowRate, MeltRateGrnd, MeltRateCanopy, eltRate,
 	                MF, Ts = -3.0, Tr = 1.0, To = 0.0, ret;
-        realtype        *metarr;
+        realtype        metarr[7];
 
 	Model_Data      MD;
 
@@ -56,10 +56,17 @@ void is_sm_et(realtype t, realtype stepsize, void *DS, N_Vector VY)
 
 //	stepsize = stepsize / UNIT_C;
 
-        metarr = (realtype *) malloc (7 * sizeof (realtype));
+	/*
+	 * Elements are independent here. The monthly tables use gmtime_r, and
+	 * forcing cursors are only read, so the loop is shared by the threads 
+	 */
+#ifdef _OPENMP
+#pragma omp parallel for private (metarr, elemSatn, AquiferDepth, beta_s, Rmax, f_r, alpha_r, eta_s, gamma_s, r_s, P_c, Delta, Gamma, Rn, T, Vel, RH, VP, P, LAI, rl, r_a, qv_sat, qv, ETp, isval, fracSnow, snowRate, MeltRateGrnd, MeltRateCanopy, MF, ret)
+#endif
 	for (i = 0; i < MD->NumEle; i++)
 	{
                 MultiInterpolation (&MD->TSD_meteo[MD->Ele[i].meteo - 1], t, metarr, 7);
+                AquiferDepth = MD->Ele[i].zmax - MD->Ele[i].zmin;
 
 		/* Note the dependence on physical units */
 //		MD->ElePrep[i] = Interpolation(&MD->Forcing[0][MD->Ele[i].prep - 1], t) / 1000.;
@@ -193,7 +200,6 @@ void is_sm_et(realtype t, realtype stepsize, void *DS, N_Vector VY)
 			P_c = (1 + Delta / Gamma) / (1 + r_s / r_a + Delta / Gamma);
 			MD->EleET[i][1] = MD->pcCal.Et1 * MD->Ele[i].VegFrac * P_c * (1 - pow(((MD->EleIS[i] + MD->EleSnowCanopy[i] < 0) ? 0 : (MD->EleIS[i] + MD->EleSnowCanopy[i])) / (MD->EleISmax[i] + MD->EleISsnowmax[i]), MD->fx_canopy)) * ETp;
 			MD->EleET[i][1] = MD->EleET[i][1] < 0 ? 0 : MD->EleET[i][1];
-			AquiferDepth = MD->Ele[i].zmax - MD->Ele[i].zmin;
 			MD->EleET[i][1] = ((MD->DummyY[i + 2 * MD->NumEle] < (AquiferDepth - MD->Ele[i].RzD)) && MD->DummyY[i + MD->NumEle] <= 0) ? 0 : MD->EleET[i][1];
 
 			MD->EleTF[i] = MD->EleIS[i] <= 0 ? 0 : 5.65 * pow(10, -2) * MD->EleISmax[i] * exp(3.89 * (MD->EleIS[i] < 0 ? 0 : MD->EleIS[i]) / MD->EleISmax[i]);	/* Note the dependece on  physical units */
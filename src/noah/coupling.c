@@ -29,15 +29,13 @@ void PIHM2Noah (realtype t, realtype stepsize, Model_Data PIHM, LSM_STRUCT LSM)
 
     double          Soldown, Sdir, Sdif, gvf;
     double          incidence, azimuth180;
-    time_t         *rawtime;
+    time_t          rawtime;
     struct tm      *timestamp;
     double          metarr[7];
 
     spa_data        spa;
-    rawtime = (time_t *) malloc (sizeof (time_t));
-    *rawtime = (int)t;
-    timestamp = gmtime (rawtime);
-    free (rawtime);
+    rawtime = (int)t;
+    timestamp = gmtime (&rawtime);
 
     spa.year = timestamp->tm_year + 1900;
     spa.month = timestamp->tm_mon + 1;
@@ -52,10 +50,7 @@ void PIHM2Noah (realtype t, realtype stepsize, Model_Data PIHM, LSM_STRUCT LSM)
 
     spa.longitude = LSM->LONGITUDE;
     spa.latitude = LSM->LATITUDE;
-    spa.elevation = 0.;
-    for (i = 0; i < PIHM->NumEle; i++)
-        spa.elevation = spa.elevation + (double)PIHM->Ele[i].zmax;
-    spa.elevation = spa.elevation / (double)PIHM->NumEle;
+    spa.elevation = LSM->ELEVATION;
     /*
      * Calculate surface pressure based on FAO 1998 method (Narasimhan 2002) 
      */
@@ -72,6 +67,13 @@ void PIHM2Noah (realtype t, realtype stepsize, Model_Data PIHM, LSM_STRUCT LSM)
     }
     spa.azimuth180 = mod ((360. + spa.azimuth180), 360.);
 
+    /*
+     * Grids are independent once the solar position is known, and SFLX
+     * keeps no state between calls, so grids are shared by the threads 
+     */
+#ifdef _OPENMP
+#pragma omp parallel for private (NOAH, metarr, RH, Sdir, Sdif, Soldown, SVP, E, T1V, TH2V, T2V, RHO, ES, A23M4, j)
+#endif
     for (i = 0; i < PIHM->NumEle; i++)
 //    for (i = 0; i < 1; i++)
     {
@@ -239,6 +241,10 @@ void Noah2PIHM (Model_Data PIHM, LSM_STRUCT LSM)
     int             CVFRZ = 3;
 
     int             i, j;
+
+#ifdef _OPENMP
+#pragma omp parallel for private (NOAH, ETsat, FCR, ACRT, DICE, SUM, IALP1, J, JJ, K, j)
+#endif
     for (i = 0; i < PIHM->NumEle; i++)
     {
         NOAH = &(LSM->GRID[i]);
@@ -10,6 +10,7 @@ void            LSM_read (char *, LSM_STRUCT);
 void            LSM_initialize_output (char *, Model_Data, LSM_STRUCT,
    char *);
 void            LSM_PrintInit (Model_Data, LSM_STRUCT, char *);
+void            LSM_MemReport (Model_Data, LSM_STRUCT);
 void            LSM_FreeData (Model_Data, LSM_STRUCT);
 
 void            PIHM2Noah (realtype, realtype, Model_Data, LSM_STRUCT);
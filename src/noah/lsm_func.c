@@ -21,6 +21,7 @@ void LSM_read (char *filename, LSM_STRUCT LSM)
     char           *projectname;
     char           *token, *tempname;
     time_t          rawtime;
+    double          value[2];
     struct tm      *timeinfo;
     FILE           *lsm_file;
     FILE           *lsm_forc_file;
@@ -217,10 +218,8 @@ void LSM_read (char *filename, LSM_STRUCT LSM)
         for (i = 0; i < NumTS; i++)
         {
             printf ("Length = %d\n", LSM->TSD_rad[i].length);
-            LSM->TSD_rad[i].TS = (double **) malloc ((LSM->TSD_rad[i].length) * sizeof (double *));
+            AllocTS (&LSM->TSD_rad[i], 3);
             LSM->TSD_rad[i].iCounter = 0;
-            for (j = 0; j < LSM->TSD_rad[i].length; j++)
-                LSM->TSD_rad[i].TS[j] = (double *) malloc (3 * sizeof (double));
         }
 
         rewind(lsm_forc_file);
@@ -234,11 +233,13 @@ void LSM_read (char *filename, LSM_STRUCT LSM)
 
             for (j = 0; j < LSM->TSD_rad[i].length; j++)
             {
-                fscanf (lsm_forc_file, "%d-%d-%d %d:%d:%d %lf %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &LSM->TSD_rad[i].TS[j][1], &LSM->TSD_rad[i].TS[j][2]);
+                fscanf (lsm_forc_file, "%d-%d-%d %d:%d:%d %lf %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &value[0], &value[1]);
                 timeinfo->tm_year = timeinfo->tm_year - 1900;
                 timeinfo->tm_mon = timeinfo->tm_mon - 1;
                 rawtime = timegm (timeinfo);
-                LSM->TSD_rad[i].TS[j][0] = (double) rawtime;
+                LSM->TSD_rad[i].Time[j] = (double) rawtime;
+                LSM->TSD_rad[i].TS[j][0] = value[0];
+                LSM->TSD_rad[i].TS[j][1] = value[1];
             }
         }
         fclose (lsm_forc_file);
@@ -273,6 +274,9 @@ void LSM_initialize (char *filename, Model_Data PIHM, Control_Data * CS, LSM_STR
            ("\tSHDFAC\tNROOT\tRS\tRGL\tHS\tSNUP\tLAIMAX\tLAIMIN\tEMISSMIN\tEMISSMAX\tALBEDOMIN\tALBEDOMAX\tZ0MIN\tZ0MAX\tCMCFACTR\n");
     }
 
+    /* Element surface elevations do not change during a run */
+    LSM->ELEVATION = (double)FixedSum (PIHM->EleZmax, PIHM->NumEle) / (double)PIHM->NumEle;
+
     LSM->VEGTBL.LUCATS = PIHM->NumLC;
     for (i = 0; i < LSM->VEGTBL.LUCATS; i++)
     {
@@ -766,9 +770,10 @@ void LSM_initialize (char *filename, Model_Data PIHM, Control_Data * CS, LSM_STR
             printf ("\n Fatal Error: %s.lsminit is in use of does not exist!\n", filename);
             exit (1);
         }
+        /* Elements are stored in the order of the .mesh file */
         for (i = 0; i < PIHM->NumEle; i++)
         {
-            NOAH = &(LSM->GRID[i]);
+            NOAH = &(LSM->GRID[PIHM->EleLoc[i]]);
             NOAH->STC = (double *)malloc ((LSM->STD_NSOIL + 1) * sizeof (double));
             NOAH->SMC = (double *)malloc ((LSM->STD_NSOIL + 1) * sizeof (double));
             NOAH->SH2O = (double *)malloc ((LSM->STD_NSOIL + 1) * sizeof (double));
@@ -779,8 +784,8 @@ void LSM_initialize (char *filename, Model_Data PIHM, Control_Data * CS, LSM_STR
                 fscanf (init_file, "%lf", &NOAH->SMC[j]);
             for (j = 0; j < LSM->STD_NSOIL + 1; j++)
                 fscanf (init_file, "%lf", &NOAH->SH2O[j]);
-            NOAH->CMC = (double)PIHM->EleIS[i];
-            NOAH->SNEQV = (double)PIHM->EleSnow[i];
+            NOAH->CMC = (double)PIHM->EleIS[PIHM->EleLoc[i]];
+            NOAH->SNEQV = (double)PIHM->EleSnow[PIHM->EleLoc[i]];
         }
     }
 }
@@ -809,7 +814,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].T1);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].T1);
         icounter++;
     }
     if (LSM->PRINT_STC > 0)
@@ -824,7 +829,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
                (double **)malloc (LSM->PCtrl[icounter].NumVar *
                sizeof (double *));
             for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-                LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].STC[j]);
+                LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].STC[j]);
             icounter++;
         }
     }
@@ -840,7 +845,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
                (double **)malloc (LSM->PCtrl[icounter].NumVar *
                sizeof (double *));
             for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-                LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].SMC[j]);
+                LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].SMC[j]);
             icounter++;
         }
     }
@@ -856,7 +861,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
                (double **)malloc (LSM->PCtrl[icounter].NumVar *
                sizeof (double *));
             for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-                LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].SH2O[j]);
+                LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].SH2O[j]);
             icounter++;
         }
     }
@@ -870,7 +875,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].SNOWH);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].SNOWH);
         icounter++;
     }
     if (LSM->PRINT_ALBEDO > 0)
@@ -883,7 +888,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].ALBEDO);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].ALBEDO);
         icounter++;
     }
     if (LSM->PRINT_LE > 0)
@@ -895,7 +900,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].ETA);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].ETA);
         icounter++;
     }
     if (LSM->PRINT_SH > 0)
@@ -907,7 +912,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].SHEAT);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].SHEAT);
         icounter++;
     }
     if (LSM->PRINT_G > 0)
@@ -919,7 +924,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].SSOIL);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].SSOIL);
         icounter++;
     }
     if (LSM->PRINT_ETP > 0)
@@ -931,7 +936,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
            (double **)malloc (LSM->PCtrl[icounter].NumVar *
            sizeof (double *));
         for (i = 0; i < LSM->PCtrl[icounter].NumVar; i++)
-            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[i].ETP);
+            LSM->PCtrl[icounter].PrintVar[i] = &(LSM->GRID[PIHM->EleLoc[i]].ETP);
         icounter++;
     }
     LSM->NPRINT = icounter;
@@ -946,7 +951,7 @@ void LSM_initialize_output (char *filename, Model_Data PIHM, LSM_STRUCT LSM, cha
         Ofile = fopen (LSM->PCtrl[i].name, "w");
         fclose (Ofile);
         LSM->PCtrl[i].buffer =
-           (double *)calloc (LSM->PCtrl[i].NumVar, sizeof (double));
+           (storetype *) calloc (LSM->PCtrl[i].NumVar, sizeof (storetype));
     }
 }
 
@@ -975,6 +980,29 @@ void LSM_FreeData (Model_Data PIHM, LSM_STRUCT LSM)
     free (LSM->STD_SLDPTH);
 }
 
+/*
+ * Memory held by the Noah grid, radiation forcing and LSM outputs 
+ */
+void LSM_MemReport (Model_Data PIHM, LSM_STRUCT LSM)
+{
+    size_t          grid, forc, out;
+    int             i;
+
+    grid = PIHM->NumEle * (sizeof (GRID_TYPE) + 4 * (LSM->STD_NSOIL + 1) * sizeof (double));
+    for (i = 0; i < PIHM->NumEle; i++)
+        grid += 3 * LSM->GRID[i].NSOIL * sizeof (double);
+    forc = 0;
+    for (i = 0; i < PIHM->NumTS; i++)
+        forc += SizeTS (&LSM->TSD_rad[i]);
+    out = 0;
+    for (i = 0; i < LSM->NPRINT; i++)
+        out += LSM->PCtrl[i].NumVar * (sizeof (storetype) + sizeof (double *));
+
+    PrintMem ("Noah grid", grid);
+    PrintMem ("Radiation forcing", forc);
+    PrintMem ("LSM output buffers", out);
+}
+
 void LSM_PrintInit (Model_Data PIHM, LSM_STRUCT LSM, char *filename)
 {
     FILE           *init_file;
@@ -987,13 +1015,13 @@ void LSM_PrintInit (Model_Data PIHM, LSM_STRUCT LSM, char *filename)
 
     for (i = 0; i < PIHM->NumEle; i++)
     {
-        fprintf (init_file, "%lf\t%lf", LSM->GRID[i].T1, LSM->GRID[i].SNOWH);
+        fprintf (init_file, "%lf\t%lf", LSM->GRID[PIHM->EleLoc[i]].T1, LSM->GRID[PIHM->EleLoc[i]].SNOWH);
         for (j = 0; j < LSM->STD_NSOIL + 1; j++)
-            fprintf (init_file, "\t%lf", LSM->GRID[i].STC[j]);
+            fprintf (init_file, "\t%lf", LSM->GRID[PIHM->EleLoc[i]].STC[j]);
         for (j = 0; j < LSM->STD_NSOIL + 1; j++)
-            fprintf (init_file, "\t%lf", LSM->GRID[i].SMC[j]);
+            fprintf (init_file, "\t%lf", LSM->GRID[PIHM->EleLoc[i]].SMC[j]);
         for (j = 0; j < LSM->STD_NSOIL + 1; j++)
-            fprintf (init_file, "\t%lf", LSM->GRID[i].SH2O[j]);
+            fprintf (init_file, "\t%lf", LSM->GRID[PIHM->EleLoc[i]].SH2O[j]);
         fprintf (init_file, "\n");
     }
 
@@ -364,7 +364,7 @@ typedef struct LSM_Print_Ctrl_struct
     int             Interval;
     int             NumVar;
     double        **PrintVar;
-    double         *buffer;
+    storetype      *buffer;
 } LSM_Print_ctrl;
 
 typedef struct LSM_STRUCT
@@ -395,6 +395,8 @@ typedef struct LSM_STRUCT
 #endif
     double          LONGITUDE;
     double          LATITUDE;
+    double          ELEVATION;  /* mean element surface elevation, for the
+                                 * solar position and surface pressure */
 }              *LSM_STRUCT;
 
 void            SFLX (GRID_TYPE *);
@@ -528,6 +530,7 @@ void            LSM_read (char *, LSM_STRUCT);
 void            LSM_initialize_output (char *, Model_Data, LSM_STRUCT,
    char *);
 void            LSM_PrintInit (Model_Data, LSM_STRUCT, char *);
+void            LSM_MemReport (Model_Data, LSM_STRUCT);
 void            LSM_FreeData (Model_Data, LSM_STRUCT);
 
 void            PIHM2Noah (realtype, realtype, Model_Data, LSM_STRUCT);
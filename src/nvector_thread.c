@@ -0,0 +1,471 @@
+/*****************************************************************************
+ * File		: nvector_thread.c
+ * Function	: Serial N_Vector with threaded vector operations
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "pihm.h"
+#include "fixed_sum.h"
+
+/*
+ * Vectors shorter than this are handled by one thread. Reductions use the
+ * same blocks either way, so the limit does not change results
+ */
+#define NV_THREAD_MIN	4096
+
+/* Element-wise forms of N_VLinearSum */
+enum lin_type {LIN_SUM, LIN_DIFF, LIN_1, LIN_2, LIN_SCALE_SUM, LIN_SCALE_DIFF, LIN_GENERAL};
+
+/* Reductions that are summed over the fixed blocks */
+enum sum_type {SUM_DOT, SUM_WSQR, SUM_WSQR_MASK, SUM_ABS};
+
+/* Operands of a reduction */
+typedef struct sum_arg_type
+{
+    int             type;
+    const realtype *xd;
+    const realtype *wd;
+    const realtype *id;
+} sum_arg;
+
+/* In-order sum of one block of a reduction */
+static realtype SumBlock (long int lo, long int hi, const void *arg)
+{
+    const sum_arg  *s;
+    realtype        sum, prodi;
+    long int        i;
+
+    s = (const sum_arg *)arg;
+    sum = 0.;
+    switch (s->type)
+    {
+        case SUM_DOT:
+            for (i = lo; i < hi; i++)
+                sum = sum + s->xd[i] * s->wd[i];
+            break;
+        case SUM_WSQR:
+            for (i = lo; i < hi; i++)
+            {
+                prodi = s->xd[i] * s->wd[i];
+                sum = sum + prodi * prodi;
+            }
+            break;
+        case SUM_WSQR_MASK:
+            for (i = lo; i < hi; i++)
+            {
+                if (s->id[i] > 0.)
+                {
+                    prodi = s->xd[i] * s->wd[i];
+                    sum = sum + prodi * prodi;
+                }
+            }
+            break;
+        case SUM_ABS:
+            for (i = lo; i < hi; i++)
+                sum = sum + fabs (s->xd[i]);
+            break;
+    }
+    return sum;
+}
+
+/*
+ * Reduction over the fixed summation tree of fixed_sum.h, as in
+ * FixedSum (). The result depends only on the vector length and not on
+ * the number of threads
+ */
+static realtype BlockSum (int type, long int N, const realtype *xd, const realtype *wd, const realtype *id)
+{
+    sum_arg         s;
+
+    s.type = type;
+    s.xd = xd;
+    s.wd = wd;
+    s.id = id;
+    return (FixedTreeSum (SumBlock, &s, N, NV_THREAD_MIN));
+}
+
+/*
+ * z = a * x + b * y. The special cases of the serial vector are kept, so
+ * each element is rounded exactly as N_VLinearSum_Serial rounds it
+ */
+static void N_VLinearSum_Thread (realtype a, N_Vector x, realtype b, N_Vector y, N_Vector z)
+{
+    realtype       *v1, *v2, *zd;
+    realtype        c;
+    long int        i, N;
+    int             type;
+
+    N = NV_LENGTH_S (x);
+    zd = NV_DATA_S (z);
+    v1 = NV_DATA_S (x);
+    v2 = NV_DATA_S (y);
+    c = a;
+
+    if (b == 1. && z == y)
+    {
+        /* y <- a * x + y */
+        type = (a == 1.) ? LIN_SUM : ((a == -1.) ? LIN_DIFF : LIN_1);
+        if (type == LIN_DIFF)
+        {
+            v1 = NV_DATA_S (y);
+            v2 = NV_DATA_S (x);
+        }
+    }
+    else if (a == 1. && z == x)
+    {
+        /* x <- b * y + x */
+        c = b;
+        v1 = NV_DATA_S (y);
+        v2 = NV_DATA_S (x);
+        type = (b == 1.) ? LIN_SUM : ((b == -1.) ? LIN_DIFF : LIN_1);
+        if (type == LIN_DIFF)
+        {
+            v1 = NV_DATA_S (x);
+            v2 = NV_DATA_S (y);
+        }
+    }
+    else if (a == 1. && b == 1.)
+        type = LIN_SUM;
+    else if ((a == 1. && b == -1.) || (a == -1. && b == 1.))
+    {
+        /* v1 - v2 */
+        type = LIN_DIFF;
+        if (a == -1.)
+        {
+            v1 = NV_DATA_S (y);
+            v2 = NV_DATA_S (x);
+        }
+    }
+    else if (a == 1. || b == 1.)
+    {
+        /* c * v1 + v2 */
+        type = LIN_1;
+        if (a == 1.)
+        {
+            c = b;
+            v1 = NV_DATA_S (y);
+            v2 = NV_DATA_S (x);
+        }
+    }
+    else if (a == -1. || b == -1.)
+    {
+        /* c * v1 - v2 */
+        type = LIN_2;
+        if (a == -1.)
+        {
+            c = b;
+            v1 = NV_DATA_S (y);
+            v2 = NV_DATA_S (x);
+        }
+    }
+    else if (a == b)
+        type = LIN_SCALE_SUM;
+    else if (a == -b)
+        type = LIN_SCALE_DIFF;
+    else
+        type = LIN_GENERAL;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+    {
+        switch (type)
+        {
+            case LIN_SUM:
+                zd[i] = v1[i] + v2[i];
+                break;
+            case LIN_DIFF:
+                zd[i] = v1[i] - v2[i];
+                break;
+            case LIN_1:
+                zd[i] = c * v1[i] + v2[i];
+                break;
+            case LIN_2:
+                zd[i] = c * v1[i] - v2[i];
+                break;
+            case LIN_SCALE_SUM:
+                zd[i] = c * (v1[i] + v2[i]);
+                break;
+            case LIN_SCALE_DIFF:
+                zd[i] = c * (v1[i] - v2[i]);
+                break;
+            default:
+                zd[i] = a * v1[i] + b * v2[i];
+                break;
+        }
+    }
+}
+
+static void N_VConst_Thread (realtype c, N_Vector z)
+{
+    realtype       *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (z);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = c;
+}
+
+static void N_VProd_Thread (N_Vector x, N_Vector y, N_Vector z)
+{
+    realtype       *xd, *yd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    yd = NV_DATA_S (y);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = xd[i] * yd[i];
+}
+
+static void N_VDiv_Thread (N_Vector x, N_Vector y, N_Vector z)
+{
+    realtype       *xd, *yd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    yd = NV_DATA_S (y);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = xd[i] / yd[i];
+}
+
+static void N_VScale_Thread (realtype c, N_Vector x, N_Vector z)
+{
+    realtype       *xd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = c * xd[i];
+}
+
+static void N_VAbs_Thread (N_Vector x, N_Vector z)
+{
+    realtype       *xd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = fabs (xd[i]);
+}
+
+static void N_VInv_Thread (N_Vector x, N_Vector z)
+{
+    realtype       *xd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = 1. / xd[i];
+}
+
+static void N_VAddConst_Thread (N_Vector x, realtype b, N_Vector z)
+{
+    realtype       *xd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = xd[i] + b;
+}
+
+static realtype N_VDotProd_Thread (N_Vector x, N_Vector y)
+{
+    return (BlockSum (SUM_DOT, NV_LENGTH_S (x), NV_DATA_S (x), NV_DATA_S (y), NULL));
+}
+
+static realtype N_VMaxNorm_Thread (N_Vector x)
+{
+    realtype       *xd;
+    realtype        max;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    max = 0.;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction (max:max) if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+    {
+        if (fabs (xd[i]) > max)
+            max = fabs (xd[i]);
+    }
+
+    return (max);
+}
+
+static realtype N_VWrmsNorm_Thread (N_Vector x, N_Vector w)
+{
+    realtype        sum;
+
+    sum = BlockSum (SUM_WSQR, NV_LENGTH_S (x), NV_DATA_S (x), NV_DATA_S (w), NULL);
+
+    return (RSqrt (sum / NV_LENGTH_S (x)));
+}
+
+static realtype N_VWrmsNormMask_Thread (N_Vector x, N_Vector w, N_Vector id)
+{
+    realtype        sum;
+
+    sum = BlockSum (SUM_WSQR_MASK, NV_LENGTH_S (x), NV_DATA_S (x), NV_DATA_S (w), NV_DATA_S (id));
+
+    return (RSqrt (sum / NV_LENGTH_S (x)));
+}
+
+static realtype N_VMin_Thread (N_Vector x)
+{
+    realtype       *xd;
+    realtype        min;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    min = xd[0];
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction (min:min) if (N > NV_THREAD_MIN)
+#endif
+    for (i = 1; i < N; i++)
+    {
+        if (xd[i] < min)
+            min = xd[i];
+    }
+
+    return (min);
+}
+
+static realtype N_VWL2Norm_Thread (N_Vector x, N_Vector w)
+{
+    return (RSqrt (BlockSum (SUM_WSQR, NV_LENGTH_S (x), NV_DATA_S (x), NV_DATA_S (w), NULL)));
+}
+
+static realtype N_VL1Norm_Thread (N_Vector x)
+{
+    return (BlockSum (SUM_ABS, NV_LENGTH_S (x), NV_DATA_S (x), NULL, NULL));
+}
+
+static void N_VCompare_Thread (realtype c, N_Vector x, N_Vector z)
+{
+    realtype       *xd, *zd;
+    long int        i, N;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    zd = NV_DATA_S (z);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+        zd[i] = (fabs (xd[i]) >= c) ? 1. : 0.;
+}
+
+/*
+ * z = 1 / x where no element of x is zero. Unlike the serial vector, z is
+ * filled in full before the test fails, which CVODE does not rely on
+ */
+static booleantype N_VInvTest_Thread (N_Vector x, N_Vector z)
+{
+    realtype       *xd, *zd;
+    long int        i, N;
+    int             nonzero;
+
+    N = NV_LENGTH_S (x);
+    xd = NV_DATA_S (x);
+    zd = NV_DATA_S (z);
+    nonzero = 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction (&&:nonzero) if (N > NV_THREAD_MIN)
+#endif
+    for (i = 0; i < N; i++)
+    {
+        if (xd[i] == 0.)
+            nonzero = 0;
+        else
+            zd[i] = 1. / xd[i];
+    }
+
+    return (nonzero ? TRUE : FALSE);
+}
+
+/*
+ * Create a serial vector whose vector operations are shared by the
+ * threads. The data layout is that of the serial vector, so NV_DATA_S and
+ * N_VDestroy_Serial apply, and clones made by the solver inherit the
+ * threaded operations. The constraint operations are left serial
+ */
+N_Vector N_VNew_Thread (long int length)
+{
+    N_Vector        v;
+
+    v = N_VNew_Serial (length);
+    if (v == NULL)
+        return (NULL);
+
+    v->ops->nvlinearsum = N_VLinearSum_Thread;
+    v->ops->nvconst = N_VConst_Thread;
+    v->ops->nvprod = N_VProd_Thread;
+    v->ops->nvdiv = N_VDiv_Thread;
+    v->ops->nvscale = N_VScale_Thread;
+    v->ops->nvabs = N_VAbs_Thread;
+    v->ops->nvinv = N_VInv_Thread;
+    v->ops->nvaddconst = N_VAddConst_Thread;
+    v->ops->nvdotprod = N_VDotProd_Thread;
+    v->ops->nvmaxnorm = N_VMaxNorm_Thread;
+    v->ops->nvwrmsnorm = N_VWrmsNorm_Thread;
+    v->ops->nvwrmsnormmask = N_VWrmsNormMask_Thread;
+    v->ops->nvmin = N_VMin_Thread;
+    v->ops->nvwl2norm = N_VWL2Norm_Thread;
+    v->ops->nvl1norm = N_VL1Norm_Thread;
+    v->ops->nvcompare = N_VCompare_Thread;
+    v->ops->nvinvtest = N_VInvTest_Thread;
+
+    return (v);
+}
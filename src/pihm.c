@@ -39,6 +39,10 @@
 #include "bgc/bgc.h"
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 int main (int argc, char *argv[])
 {
     Model_Data      mData;      /* Model Data */
@@ -48,11 +52,15 @@ int main (int argc, char *argv[])
     int             flag;       /* flag to test return value */
     FILE           *iproj;      /* Project File */
     int             N;          /* Problem size */
-    int             i, j, k;    /* loop index */
+    int             j, k;       /* loop index */
     realtype        t;          /* simulation time */
     struct tm      *timestamp;
     time_t         *rawtime;
     realtype        NextPtr, StepSize;  /* stress period & step size */
+    realtype        StepEnd;    /* end of the last model step */
+    Event_Queue     events;     /* pending model events */
+    Event           event;
+    int             done;
     realtype        cvode_val;
     long int        cvode_int;
     char           *filename, *outputdir, str[11];
@@ -150,6 +158,14 @@ int main (int argc, char *argv[])
     BGC_read (filename, BGCM, mData);
 #endif
 
+#ifdef _OPENMP
+    if (cData.NumThreads > 0)
+        omp_set_num_threads (cData.NumThreads);
+    printf ("\n    RHS evaluation uses %d threads.\n", omp_get_max_threads ());
+    if (cData.ThreadVec)
+        printf ("    Solver vector operations are threaded.\n");
+#endif
+
     //if(mData->UnsatMode ==1)
     //{    
     //}
@@ -160,7 +176,7 @@ int main (int argc, char *argv[])
         mData->DummyY = (realtype *) malloc ((3 * mData->NumEle + 2 * mData->NumRiv) * sizeof (realtype));
     }
     /* initial state variable depending on machine */
-    CV_Y = N_VNew_Serial (N);
+    CV_Y = cData.ThreadVec ? N_VNew_Thread (N) : N_VNew_Serial (N);
 
     /* initialize mode data structure */
     initialize (filename, mData, &cData, CV_Y);
@@ -177,6 +193,15 @@ int main (int argc, char *argv[])
     LSM_initialize_output (filename, mData, LSM, outputdir);
 #endif
 
+    /* Report memory held by each subsystem */
+    MemReport (mData, &cData);
+#ifdef _FLUX_PIHM_
+    LSM_MemReport (mData, LSM);
+#endif
+#ifdef _BGC_
+    BGC_MemReport (mData, BGCM);
+#endif
+
 #ifdef _BGC_
     if (BGCM->ctrl.spinup == 1)
     {
@@ -199,65 +224,114 @@ int main (int argc, char *argv[])
     flag = CVodeSetInitStep (cvode_mem, cData.InitStep);
     flag = CVodeSetStabLimDet (cvode_mem, TRUE);
     flag = CVodeSetMaxStep (cvode_mem, cData.MaxStep);
-    flag = CVodeMalloc (cvode_mem, f, cData.StartTime, CV_Y, CV_SS, cData.reltol, &cData.abstol);
-    flag = CVSpgmr (cvode_mem, PREC_NONE, 0);
+    flag = CVodeSetMaxOrd (cvode_mem, SOLVER_MAXORD);
+    flag = CVodeMalloc (cvode_mem, SelectRHS (mData), cData.StartTime, CV_Y, CV_SS, cData.reltol, &cData.abstol);
+    flag = CVSpgmr (cvode_mem, PREC_NONE, SOLVER_MAXL);
+    mData->CVMem = cvode_mem;
+    flag = CVSpgmrSetJacTimesVecFn (cvode_mem, JacTimes, mData);
     //  flag = CVSpgmrSetGSType(cvode_mem, MODIFIED_GS);
 
     /* set start time */
     t = cData.StartTime;
+    StepSize = 0.;
+    StepEnd = t;
+
+    /*
+     * Schedule recurring events. Model steps follow the external time
+     * stepping controls (the i-th step is a^i * b long), the land surface
+     * steps every ETStep from the start, and outputs are written at the
+     * multiples of their intervals 
+     */
+    InitEvents (&events);
+    AddEvent (&events, STEP_EVENT, 0, t + cData.a * cData.b, cData.a * cData.a * cData.b, cData.a);
+    AddEvent (&events, ET_EVENT, 0, t, cData.ETStep, 1.);
+    for (j = 0; j < cData.NumPrint; j++)
+        AddEvent (&events, PRINT_EVENT, j, (floor (t / cData.PCtrl[j].Interval) + 1.) * cData.PCtrl[j].Interval, cData.PCtrl[j].Interval, 1.);
+#ifdef _FLUX_PIHM_
+    for (j = 0; j < LSM->NPRINT; j++)
+        AddEvent (&events, LSM_PRINT_EVENT, j, (floor (t / LSM->PCtrl[j].Interval) + 1.) * LSM->PCtrl[j].Interval, LSM->PCtrl[j].Interval, 1.);
+#endif
 
-    /* start solver in loops */
-    for (i = 0; i < cData.NumSteps; i++)
+    /* start solver in loops, advancing from one event to the next */
+    done = 0;
+    while (!done)
     {
-        /* inner loops to next output points with ET step size control */
-        while (t < cData.Tout[i + 1])
+        /* Handle events that are due */
+        while (NextEventTime (&events) <= t)
         {
-            if (t + cData.ETStep >= cData.Tout[i + 1])
-                NextPtr = cData.Tout[i + 1];
-            else
-                NextPtr = t + cData.ETStep;
-            StepSize = NextPtr - t;
-
-            mData->dt = StepSize;
-
-            if ((int)t % (int)cData.ETStep == 0)
+            PopEvent (&events, &event);
+            switch (event.type)
             {
+                case STEP_EVENT:
+                    /* A remainder shorter than a step is merged into the
+                     * last step so that the run ends at EndTime */
+                    if (t < cData.EndTime && t + event.interval > cData.EndTime)
+                    {
+                        AddEvent (&events, STEP_EVENT, 0, cData.EndTime, 0., 1.);
+                        break;
+                    }
+                    for (j = 0; j < cData.NumPrint; j++)
+                        AccumData (cData.PCtrl[j]);
 #ifdef _FLUX_PIHM_
-                /* calculate surface energy balance */
-                PIHM2Noah (t, cData.ETStep, mData, LSM);
-                Noah2PIHM (mData, LSM);
+                    for (j = 0; j < LSM->NPRINT; j++)
+                        AccumData (LSM->PCtrl[j]);
+#endif
+                    StepEnd = t;
+                    done = (t >= cData.EndTime);
+                    break;
+                case PRINT_EVENT:
+                    /* Outputs are only written at the end of a model step */
+                    if (t == StepEnd)
+                        PrintData (cData.PCtrl[event.index], t, StepSize, cData.Ascii);
+                    break;
+#ifdef _FLUX_PIHM_
+                case LSM_PRINT_EVENT:
+                    if (t == StepEnd)
+                        PrintData (LSM->PCtrl[event.index], t, StepSize, cData.Ascii);
+                    break;
+#endif
+                case ET_EVENT:
+                    if (done)
+                        break;
+#ifdef _FLUX_PIHM_
+                    /* calculate surface energy balance */
+                    PIHM2Noah (t, cData.ETStep, mData, LSM);
+                    Noah2PIHM (mData, LSM);
 #else
-                /* calculate Interception Storage and ET */
-                is_sm_et (t, cData.ETStep, mData, CV_Y);
+                    /* calculate Interception Storage and ET */
+                    is_sm_et (t, cData.ETStep, mData, CV_Y);
 #endif
+                    break;
             }
+        }
+        if (done)
+            break;
+
+        /* Advance to the next event */
+        NextPtr = NextEventTime (&events);
+        StepSize = NextPtr - t;
+
+        mData->dt = StepSize;
 
 #ifdef COUPLE_I
-            t = NextPtr;
+        t = NextPtr;
 #else
-            /* Added to adatpt to larger time step. YS */
-            flag = CVodeSetMaxNumSteps(cvode_mem, (long int)(StepSize* 10));
-            flag = CVode (cvode_mem, NextPtr, CV_Y, &t, CV_NORMAL);
-            flag = CVodeGetCurrentTime(cvode_mem, &cvode_val);
+        /* Added to adatpt to larger time step. YS */
+        flag = CVodeSetMaxNumSteps(cvode_mem, (long int)(StepSize* 10));
+        flag = CVode (cvode_mem, NextPtr, CV_Y, &t, CV_NORMAL);
+        flag = CVodeGetCurrentTime(cvode_mem, &cvode_val);
 #endif
-            *rawtime = (int)t;
-            timestamp = gmtime (rawtime);
-            if ((int)*rawtime % 3600 == 0)
-                printf (" Time = %4.4d-%2.2d-%2.2d %2.2d:%2.2d\n", timestamp->tm_year + 1900, timestamp->tm_mon + 1, timestamp->tm_mday, timestamp->tm_hour, timestamp->tm_min);
-            summary (mData, CV_Y, t - StepSize, StepSize);
-            update (t, mData);
-        }
+        *rawtime = (int)t;
+        timestamp = gmtime (rawtime);
+        if ((int)*rawtime % 3600 == 0)
+            printf (" Time = %4.4d-%2.2d-%2.2d %2.2d:%2.2d\n", timestamp->tm_year + 1900, timestamp->tm_mon + 1, timestamp->tm_mday, timestamp->tm_hour, timestamp->tm_min);
+        summary (mData, CV_Y, StepSize);
+        update (t, mData);
+    }
+    FreeEvents (&events);
 #ifdef _BGC_
-        }
-#endif
-        /* Print outputs */
-        for (j = 0; j < cData.NumPrint; j++)
-            PrintData (cData.PCtrl[j], t, StepSize, cData.Ascii);
-#ifdef _FLUX_PIHM_
-        for (j = 0; j < LSM->NPRINT; j++)
-            PrintData (LSM->PCtrl[j], t, StepSize, cData.Ascii);
-#endif
     }
+#endif
     if (cData.Spinup)
     {
         PrintInit (mData, filename);
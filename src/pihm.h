@@ -23,6 +23,7 @@
 #include <sys/stat.h>
 #include "print.h"
 #include "forcing.h"
+#include "event.h"
 
 /* SUNDIAL Header Files */
 #include "sundials_types.h"     /* realtype, integertype, booleantype
@@ -46,6 +47,9 @@
 #define PI		3.14159265
 #define BADVAL		-999
 #define MAXSTRING	1024
+#define SUM_BLOCKS	64      /* blocks in the summation tree of fixed_sum.h */
+#define SOLVER_MAXORD	5       /* maximum BDF order of CVODE */
+#define SOLVER_MAXL	5       /* Krylov subspace dimension of CVSPGMR */
 
 /* Enumrate type for forcing time series */
 enum forcing_type {PRCP_TS, SFCTMP_TS, RH_TS, SFCSPD_TS, SOLAR_TS, LONGWAVE_TS, PRES_TS, LAI_TS, RL_TS, MF_TS, SS_TS};
@@ -138,6 +142,13 @@ typedef struct element_type
                                  * cells */
     realtype        dhBYdx;     /* Head gradient in x dirn. */
     realtype        dhBYdy;     /* Head gradient in y dirn. */
+
+    /*
+     * Time-invariant geometry, set in initialize ()
+     */
+    realtype        dist[3];    /* distance to neighbor centroid across
+                                 * edge i (circumcenter to edge i on
+                                 * boundaries) */
 } element;
 
 /*
@@ -187,6 +198,42 @@ typedef struct soils_type
                                  * head is calculated during infiltration */
 } soils;
 
+/*
+ * Piecewise linear tables of van Genuchten relative conductivity and
+ * dimensionless suction head on a uniform saturation grid, one per soil
+ * type. Intervals where linear interpolation exceeds the error bound are
+ * evaluated exactly.
+ */
+typedef struct vg_table_type
+{
+    int             n;          /* number of intervals (0: no table,
+                                 * always evaluate exactly) */
+    realtype        satnMin;    /* saturation of the first node */
+    realtype        dsatn;      /* interval width */
+    realtype       *kr;         /* relative conductivity at nodes */
+    realtype       *head;       /* suction head times Alpha at nodes */
+    char           *exact;      /* 1: interval is evaluated exactly */
+} vg_table;
+
+/*
+ * Piecewise linear tables of river cross section area and wetted perimeter
+ * on a uniform stage grid, one per river shape. Stages above the table and
+ * intervals where linear interpolation exceeds the error bound are
+ * evaluated exactly.
+ */
+typedef struct riv_table_type
+{
+    int             n;          /* number of intervals (0: no table,
+                                 * always evaluate exactly) */
+    int             order;      /* interpolation order of the shape */
+    realtype        coeff;      /* shape coefficient */
+    realtype        yMax;       /* stage of the last node */
+    realtype        dy;         /* interval width */
+    realtype       *area;       /* cross section area at nodes */
+    realtype       *perem;      /* wetted perimeter at nodes */
+    char           *exact;      /* 1: interval is evaluated exactly */
+} riv_table;
+
 typedef struct geol_type
 {
     int             index;      /* index */
@@ -256,6 +303,18 @@ typedef struct river_segment_type
     int             BC;         /* BC type */
     int             reservoir;
 
+    /*
+     * Time-invariant geometry, set in initialize ()
+     */
+    realtype        bankWid;    /* top width at bankfull depth */
+    realtype        distDown;   /* distance to down stream segment */
+    realtype        distOut;    /* distance to outlet (ToNode) */
+    realtype        distLeft;   /* distance to left element centroid */
+    realtype        distRight;  /* distance to right element centroid */
+    int             leftEdge;   /* edge of left element facing the segment */
+    int             rightEdge;  /* edge of right element facing the segment */
+    int             numUp;      /* number of up stream segments */
+    int            *up;         /* up stream segments, in increasing order */
 } river_segment;
 
 typedef struct river_shape_type
@@ -405,12 +464,16 @@ typedef struct model_data_structure
                                  * Data */
     TSD            *TSD_meteo;    /* YS */
     TSD            *TSD_lai;    /* YS */
+    int             NumLAI;     /* Number of LAI time series */
     TSD            *TSD_rl;
     TSD            *TSD_mf;     /* YS  */
     TSD            *TSD_ss;     /* YS */
     int             NumTS;      /* YS */
     TSD            *TSD_Riv;    /* River Related Time Series Data  */
 
+    /*
+     * Row pointers into contiguous blocks (3 per element, 11 per segment) 
+     */
     realtype      **FluxSurf;   /* Overland Flux */
     realtype      **FluxSub;    /* Subsurface Flux */
     realtype      **FluxRiv;    /* River Segement Flux */
@@ -428,7 +491,7 @@ typedef struct model_data_structure
     realtype       *EleISsnowmax;   /* Maximum snow interception storage */
     realtype       *EleTF;      /* Through Fall */
     realtype      **EleET;      /* Evapotranspiration (from canopy, ground,
-                                 * transpiration) */
+                                 * transpiration), contiguous like FluxSurf */
 
     realtype       *Albedo;     /* albedo of a triangular element */
 
@@ -447,6 +510,64 @@ typedef struct model_data_structure
                                  * by frozen ground */
 #endif
     realtype       *DummyY;
+
+    /*
+     * Flux arrays written by the perturbed RHS calls of JacTimes (), laid
+     * out like the ones above 
+     */
+    realtype      **JvFluxSurf;
+    realtype      **JvFluxSub;
+    realtype      **JvFluxRiv;
+    realtype       *JvEleViR;
+    realtype       *JvRecharge;
+    void           *CVMem;      /* CVODE memory, for the error weights */
+
+    /*
+     * Copies of the element fields read by every RHS call, stored as
+     * arrays and set at the end of initialize (). Ele remains the
+     * reference elsewhere. zmin, zmax, KsatH and Porosity also cover the
+     * elements beneath rivers 
+     */
+    realtype       *EleArea;
+    realtype       *EleZmin;
+    realtype       *EleZmax;
+    realtype       *EleKsatH;
+    realtype       *EleKsatV;
+    realtype       *ElePorosity;
+    realtype       *EleAlpha;
+    realtype       *EleBeta;
+    int            *EleNabr;    /* Neighbors, stored as 3 * element + edge */
+    realtype       *EleEffKH;   /* Effective horizontal conductivity of
+                                 * each element, updated every RHS call */
+    realtype       *EleSlope;   /* Magnitude of surface head gradient,
+                                 * updated every RHS call */
+    realtype       *RivEffKH;   /* Effective horizontal conductivity of
+                                 * the element beneath each river segment */
+    vg_table       *VGTbl;      /* van Genuchten tables of each soil type */
+    int            *RivLoc;     /* Position in Riv of each segment of the
+                                 * .riv file */
+    int            *EleLoc;     /* Position in Ele of each element of the
+                                 * .mesh file */
+    riv_table      *RivTbl;     /* Cross section tables of each river
+                                 * shape */
+    realtype       *RivArea;    /* Cross section area of each river
+                                 * segment, updated every RHS call */
+    realtype       *RivPerem;   /* Wetted perimeter of each river segment,
+                                 * updated every RHS call */
+
+    /*
+     * Element edges by type, stored as 3 * element + edge 
+     */
+    int             NumIntrEdge;
+    int            *IntrEdge;   /* Shared with another element */
+    int             NumRivEdge;
+    int            *RivEdge;    /* Along a river segment */
+    int             NumNoFlowEdge;
+    int            *NoFlowEdge; /* Natural (no flow) boundary */
+    int             NumDiriEdge;
+    int            *DiriEdge;   /* Dirichlet boundary */
+    int             NumNeumEdge;
+    int            *NeumEdge;   /* Neumann boundary */
     processCal      pcCal;
 
     realtype        dt;         /* YS: Time step */
@@ -461,9 +582,6 @@ typedef struct control_data_structure
     int             Spinup;     /* YS: Runs model as spinup. Model output at
                                  * the last step will be saved in .init */
     int             Solver;     /* Solver type */
-    int             NumSteps;   /* Number of external time steps (when
-                                 * results can be printed) for the
-                                 * whole simulation */
     int             NumPrint;   /* YS: Number of variables for output */
 
     /* Time interval to output average values of variables
@@ -492,6 +610,24 @@ typedef struct control_data_structure
     int             MaxK;       /* Maximum Krylov order */
     realtype        delt;
 
+    int             NumThreads; /* Number of threads for RHS evaluation
+                                 * (0: OpenMP default) */
+    realtype        VGTableTol; /* Relative error bound of tabulated van
+                                 * Genuchten functions (0: exact) */
+    int             RivTopoOrder;   /* Store river segments up stream
+                                     * first (0: order of .riv file) */
+    int             EleOrder;   /* Renumber elements by reverse
+                                 * Cuthill-McKee (0: order of .mesh file) */
+    int             LeanMem;    /* Release data only needed during
+                                 * initialization (0: keep) */
+    int             FirstTouch; /* Place element and river arrays in the
+                                 * memory of the threads that use them
+                                 * (0: off) */
+    int             ThreadVec;  /* Share solver vector operations among
+                                 * the threads (0: serial N_Vector) */
+    realtype        RivTableTol;    /* Relative error bound of tabulated
+                                     * river cross sections (0: exact) */
+
     realtype        StartTime;  /* Start time of simulation */
     realtype        EndTime;    /* End time of simulation */
 
@@ -499,8 +635,6 @@ typedef struct control_data_structure
     realtype        a;          /* External time stepping controls */
     realtype        b;
 
-    realtype       *Tout;
-
     globalCal       Cal;        /* Convert this to pointer for
                                  * localized calibration */
 } Control_Data;
@@ -512,19 +646,35 @@ typedef struct control_data_structure
 void            initialize (char *, Model_Data, Control_Data *, N_Vector);
 void            initialize_output (char *, Model_Data, Control_Data *, char *);
 int             f (realtype, N_Vector, N_Vector, void *);
+int             f_diff (realtype, N_Vector, N_Vector, void *);
+int             f_kin (realtype, N_Vector, N_Vector, void *);
+CVRhsFn         SelectRHS (Model_Data);
+int             JacTimes (N_Vector, N_Vector, realtype, N_Vector, N_Vector, void *, N_Vector);
 void            read_alloc (char *, Model_Data, Control_Data *);
-void            f_update (realtype, realtype *, void *);    /* YS */
 void            Free_Data (Model_Data, Control_Data *);
-void            summary (Model_Data, N_Vector, realtype, realtype); /* YS */
-realtype        returnVal (realtype, realtype, realtype, realtype);
-realtype        CS_AreaOrPerem (int, realtype, realtype, realtype);
+void            summary (Model_Data, N_Vector, realtype); /* YS */
+realtype        FixedSum (const realtype *, int);
+N_Vector        N_VNew_Thread (long int);
+realtype        CS_Area (int, realtype, realtype);
+realtype        CS_Perem (int, realtype, realtype);
+realtype        CS_Width (int, realtype, realtype);
 void            OverlandFlow (realtype **, int, int, realtype, realtype, realtype, realtype, realtype);
 void            OLFeleToriv (realtype, realtype, realtype, realtype, realtype, realtype **, int, int, realtype);
 realtype        avgY (realtype, realtype, realtype);
 realtype        effKV (realtype, realtype, realtype, realtype, realtype);
 realtype        effKH (int, realtype, realtype, realtype, realtype, realtype, realtype);
 realtype        FieldCapacity (realtype, realtype, realtype, realtype, realtype);
+void            InitVGTable (vg_table *, realtype, realtype, realtype);
+void            FreeVGTable (vg_table *);
+realtype        vgKr (const vg_table *, realtype, realtype);
+realtype        vgHead (const vg_table *, realtype, realtype);
+void            InitRivTable (riv_table *, int, realtype, realtype, realtype);
+void            FreeRivTable (riv_table *);
+realtype        rivArea (const riv_table *, realtype);
+realtype        rivPerem (const riv_table *, realtype);
 void            is_sm_et (realtype, realtype, void *, N_Vector);
 void            PrintInit (Model_Data, char *);
+void            PrintMem (char *, size_t);
+void            MemReport (Model_Data, Control_Data *);
 
 #endif
@@ -20,71 +20,76 @@
 #include "pihm.h"
 
 /*
- * Temporal average of State vectors 
+ * Add the current values of an output stream to its buffer. Called at the
+ * end of every model step 
+ */
+void AccumData (Print_Ctrl PCtrl)
+{
+    int             j;
+
+    for (j = 0; j < PCtrl.NumVar; j++)
+        PCtrl.buffer[j] = PCtrl.buffer[j] + *PCtrl.PrintVar[j];
+}
+
+/*
+ * Temporal average of State vectors. Called when the print event of the
+ * stream is due 
  */
 void PrintData (Print_Ctrl PCtrl, realtype tmpt, realtype dt, int Ascii)
 {
     int             j;
     struct tm      *timestamp;
-    time_t         *rawtime;
+    time_t          rawtime;
     char           *ascii_name;
     FILE           *fpin;
     realtype        outval, outtime;
 
-    rawtime = (time_t *) malloc (sizeof (time_t));
+    rawtime = (int)tmpt;
+    timestamp = gmtime (&rawtime);
+    outtime = (realtype) rawtime;
 
-    for (j = 0; j < PCtrl.NumVar; j++)
-        PCtrl.buffer[j] = PCtrl.buffer[j] + *PCtrl.PrintVar[j];
-    if (((int)tmpt % PCtrl.Interval) == 0)
+    if (Ascii)
     {
-        *rawtime = (int)tmpt;
-        timestamp = gmtime (rawtime);
-        outtime = (realtype) (*rawtime);
-
-        if (Ascii)
-        {
-            ascii_name = (char *)malloc (strlen (PCtrl.name) + 5 * sizeof (char));
-            sprintf (ascii_name, "%s.txt", PCtrl.name);
-            fpin = fopen (ascii_name, "a");
-            if (NULL == fpin)
-            {
-                printf ("\t ERROR: opening output files (%s)!", ascii_name);
-                exit (1);
-            }
-            fprintf (fpin, "\"%4.4d-%2.2d-%2.2d %2.2d:%2.2d\"\t", timestamp->tm_year + 1900, timestamp->tm_mon + 1, timestamp->tm_mday, timestamp->tm_hour, timestamp->tm_min);
-            for (j = 0; j < PCtrl.NumVar; j++)
-            {
-                if ((realtype) PCtrl.Interval > dt)
-                    fprintf (fpin, "%lf\t", PCtrl.buffer[j] / ( (realtype) PCtrl.Interval / dt));
-                else
-                    fprintf (fpin, "%lf\t", PCtrl.buffer[j]);
-            }
-            fprintf (fpin, "\n");
-            fflush (fpin);
-            fclose (fpin);
-            free (ascii_name);
-        }
-        fpin = fopen (PCtrl.name, "ab");
+        ascii_name = (char *)malloc (strlen (PCtrl.name) + 5 * sizeof (char));
+        sprintf (ascii_name, "%s.txt", PCtrl.name);
+        fpin = fopen (ascii_name, "a");
         if (NULL == fpin)
         {
-            printf ("\t ERROR: opening output files (.%s)!", PCtrl.name);
+            printf ("\t ERROR: opening output files (%s)!", ascii_name);
             exit (1);
         }
-
-        fwrite (&outtime, sizeof (realtype), 1, fpin);
+        fprintf (fpin, "\"%4.4d-%2.2d-%2.2d %2.2d:%2.2d\"\t", timestamp->tm_year + 1900, timestamp->tm_mon + 1, timestamp->tm_mday, timestamp->tm_hour, timestamp->tm_min);
         for (j = 0; j < PCtrl.NumVar; j++)
         {
             if ((realtype) PCtrl.Interval > dt)
-                outval = PCtrl.buffer[j] / ( (realtype) PCtrl.Interval / dt);
+                fprintf (fpin, "%lf\t", PCtrl.buffer[j] / ( (realtype) PCtrl.Interval / dt));
             else
-                outval = PCtrl.buffer[j];
-            fwrite (&outval, sizeof (realtype), 1, fpin);
-            PCtrl.buffer[j] = 0;
+                fprintf (fpin, "%lf\t", PCtrl.buffer[j]);
         }
+        fprintf (fpin, "\n");
         fflush (fpin);
         fclose (fpin);
+        free (ascii_name);
     }
-    free (rawtime);
+    fpin = fopen (PCtrl.name, "ab");
+    if (NULL == fpin)
+    {
+        printf ("\t ERROR: opening output files (.%s)!", PCtrl.name);
+        exit (1);
+    }
+
+    fwrite (&outtime, sizeof (realtype), 1, fpin);
+    for (j = 0; j < PCtrl.NumVar; j++)
+    {
+        if ((realtype) PCtrl.Interval > dt)
+            outval = PCtrl.buffer[j] / ( (realtype) PCtrl.Interval / dt);
+        else
+            outval = PCtrl.buffer[j];
+        fwrite (&outval, sizeof (realtype), 1, fpin);
+        PCtrl.buffer[j] = 0;
+    }
+    fflush (fpin);
+    fclose (fpin);
 }
 
 void PrintInit (Model_Data DS, char *filename)
@@ -98,8 +103,101 @@ void PrintInit (Model_Data DS, char *filename)
     free (init_name);
 
     for (i = 0; i < DS->NumEle; i++)
-        fprintf (init_file, "%lf\t%lf\t%lf\t%lf\t%lf\n", DS->EleIS[i], DS->EleSnow[i], DS->EleSurf[i], DS->EleUnsat[i], DS->EleGW[i]);
+        fprintf (init_file, "%lf\t%lf\t%lf\t%lf\t%lf\n", DS->EleIS[DS->EleLoc[i]], DS->EleSnow[DS->EleLoc[i]], DS->EleSurf[DS->EleLoc[i]], DS->EleUnsat[DS->EleLoc[i]], DS->EleGW[DS->EleLoc[i]]);
     for (i = 0; i < DS->NumRiv; i++)
-        fprintf (init_file, "%lf\t%lf\n", DS->RivStg[i], DS->EleGW[i + DS->NumEle]);
+        fprintf (init_file, "%lf\t%lf\n", DS->RivStg[DS->RivLoc[i]], DS->EleGW[DS->RivLoc[i] + DS->NumEle]);
     fclose (init_file);
 }
+
+void PrintMem (char *name, size_t bytes)
+{
+    printf ("  %-24s%12.3lf MB\n", name, (double)bytes / 1048576.);
+}
+
+/*
+ * Memory held by each subsystem after initialization, from the element
+ * counts and types of the arrays as allocated. Solver vectors are those
+ * CVODE and CVSPGMR allocate for the BDF order and Krylov dimension set in
+ * pihm.c. Allocator overhead is not counted 
+ */
+void MemReport (Model_Data DS, Control_Data * CS)
+{
+    size_t          ele, state, riv, tbl, forc, flux, work, out, nvec;
+    int             i, NE, NR;
+
+    NE = DS->NumEle;
+    NR = DS->NumRiv;
+
+    ele = (NE + NR) * sizeof (*DS->Ele) + DS->NumNode * sizeof (*DS->Node) + NE * sizeof (*DS->EleLoc);
+    ele += (DS->Ele_IC != NULL) ? NE * sizeof (*DS->Ele_IC) : 0;
+    if (CS->LeanMem)
+        ele += (DS->NumIntrEdge + DS->NumRivEdge + DS->NumNoFlowEdge + DS->NumDiriEdge + DS->NumNeumEdge) * sizeof (int);
+    else
+        ele += 5 * 3 * NE * sizeof (int);
+    ele += NE * (sizeof (*DS->EleArea) + sizeof (*DS->EleKsatV) + sizeof (*DS->EleAlpha) + sizeof (*DS->EleBeta) + 3 * sizeof (*DS->EleNabr));
+    ele += (NE + NR) * (sizeof (*DS->EleZmin) + sizeof (*DS->EleZmax) + sizeof (*DS->EleKsatH) + sizeof (*DS->ElePorosity));
+
+    state = (NE + NR) * (sizeof (*DS->EleSurf) + sizeof (*DS->EleGW));
+    state += NE * (sizeof (*DS->EleUnsat) + sizeof (*DS->ElePrep) + sizeof (*DS->EleNetPrep) + sizeof (*DS->EleIS) + sizeof (*DS->EleISmax) + sizeof (*DS->EleISsnowmax) + sizeof (*DS->EleSnow) + sizeof (*DS->EleSnowGrnd) + sizeof (*DS->EleSnowCanopy) + sizeof (*DS->EleTF) + sizeof (*DS->EleEffKH) + sizeof (*DS->EleSlope));
+    state += (DS->Albedo != NULL) ? NE * sizeof (*DS->Albedo) : 0;
+#ifdef _FLUX_PIHM_
+    state += NE * (sizeof (*DS->SfcSat) + sizeof (*DS->EleETsat) + sizeof (*DS->EleFCR));
+#endif
+
+    riv = NR * (sizeof (*DS->Riv) + sizeof (*DS->RivLoc) + sizeof (*DS->RivStg) + sizeof (*DS->RivEffKH) + sizeof (*DS->RivArea) + sizeof (*DS->RivPerem));
+    for (i = 0; i < NR; i++)
+        riv += (DS->Riv[i].numUp > 0 ? DS->Riv[i].numUp : 1) * sizeof (*DS->Riv[i].up);
+    riv += (DS->Riv_IC != NULL) ? DS->NumRivIC * sizeof (*DS->Riv_IC) : 0;
+    riv += DS->NumRivShape * sizeof (*DS->Riv_Shape) + DS->NumRivMaterial * sizeof (*DS->Riv_Mat);
+
+    tbl = DS->NumSoil * (sizeof (*DS->Soil) + sizeof (*DS->VGTbl)) + DS->NumGeol * sizeof (*DS->Geol);
+    tbl += DS->NumLC * (sizeof (*DS->LandC) + sizeof (*DS->ISFactor)) + DS->NumRivShape * sizeof (*DS->RivTbl);
+    for (i = 0; i < DS->NumSoil; i++)
+        tbl += (DS->VGTbl[i].n > 0) ? (DS->VGTbl[i].n + 1) * (sizeof (*DS->VGTbl[i].kr) + sizeof (*DS->VGTbl[i].head)) + DS->VGTbl[i].n * sizeof (*DS->VGTbl[i].exact) : 0;
+    for (i = 0; i < DS->NumRivShape; i++)
+        tbl += (DS->RivTbl[i].n > 0) ? (DS->RivTbl[i].n + 1) * (sizeof (*DS->RivTbl[i].area) + sizeof (*DS->RivTbl[i].perem)) + DS->RivTbl[i].n * sizeof (*DS->RivTbl[i].exact) : 0;
+
+    forc = DS->NumTS * sizeof (*DS->windH);
+    for (i = 0; i < DS->NumTS; i++)
+        forc += SizeTS (&DS->TSD_meteo[i]);
+    for (i = 0; i < DS->NumRivBC; i++)
+        forc += SizeTS (&DS->TSD_Riv[i]);
+    for (i = 0; i < DS->Num1BC + DS->Num2BC; i++)
+        forc += SizeTS (&DS->TSD_EleBC[i]);
+    for (i = 0; i < DS->NumLAI; i++)
+        forc += SizeTS (&DS->TSD_lai[i]);
+
+    /* Each flux block and its row pointers, and the copies of JacTimes () */
+    flux = 3 * NE * (sizeof (**DS->FluxSurf) + sizeof (**DS->FluxSub) + sizeof (**DS->EleET)) + 11 * NR * sizeof (**DS->FluxRiv);
+    flux += NE * (sizeof (*DS->FluxSurf) + sizeof (*DS->FluxSub) + sizeof (*DS->EleET)) + NR * sizeof (*DS->FluxRiv);
+    flux += NE * (sizeof (*DS->EleViR) + sizeof (*DS->Recharge));
+    flux += 3 * NE * (sizeof (**DS->JvFluxSurf) + sizeof (**DS->JvFluxSub)) + 11 * NR * sizeof (**DS->JvFluxRiv);
+    flux += NE * (sizeof (*DS->JvFluxSurf) + sizeof (*DS->JvFluxSub)) + NR * sizeof (*DS->JvFluxRiv);
+    flux += NE * (sizeof (*DS->JvEleViR) + sizeof (*DS->JvRecharge));
+
+    /*
+     * DummyY and CV_Y, then the vectors CVODE allocates (SOLVER_MAXORD + 1
+     * history vectors, ewt, acor, tempv and ftemp) and CVSPGMR allocates
+     * (SOLVER_MAXL + 1 Krylov vectors, xcor, vtemp, ytemp and x, and the
+     * Hessenberg matrix, Givens rotations and least squares vector) 
+     */
+    nvec = (3 * NE + 2 * NR) * sizeof (realtype);
+    work = (3 * NE + 2 * NR) * sizeof (*DS->DummyY) + nvec;
+    work += (SOLVER_MAXORD + 1 + 4) * nvec;
+    work += (SOLVER_MAXL + 1 + 4) * nvec + ((SOLVER_MAXL + 1) * SOLVER_MAXL + 2 * SOLVER_MAXL + SOLVER_MAXL + 1) * sizeof (realtype);
+
+    out = 0;
+    for (i = 0; i < CS->NumPrint; i++)
+        out += CS->PCtrl[i].NumVar * (sizeof (*CS->PCtrl[i].buffer) + sizeof (*CS->PCtrl[i].PrintVar));
+
+    printf ("\nMemory usage%s:\n", CS->LeanMem ? " (lean mode)" : "");
+    PrintMem ("Elements and nodes", ele);
+    PrintMem ("Element states", state);
+    PrintMem ("River segments", riv);
+    PrintMem ("Lookup tables", tbl);
+    PrintMem ("Forcing time series", forc);
+    PrintMem ("Flux arrays", flux);
+    PrintMem ("Solver work arrays", work);
+    PrintMem ("Output buffers", out);
+    PrintMem ("Total", ele + state + riv + tbl + forc + flux + work + out);
+}
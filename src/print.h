@@ -15,14 +15,17 @@
 #ifndef PRINT_HEADER
 #define PRINT_HEADER
 
+#include "forcing.h"
+
 typedef struct Print_Ctrl_structure /* YS */
 {
     char            name[100];
     int             Interval;
     int             NumVar;
     double        **PrintVar;
-    double         *buffer;
+    storetype      *buffer;
 } Print_Ctrl;
 
+void            AccumData (Print_Ctrl);
 void            PrintData (Print_Ctrl, double, double, int);
 #endif
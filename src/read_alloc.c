@@ -26,7 +26,6 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
     int             ind;
     int             ensemble_mode;
 
-    int             NumTout;
     char           *fn[10];
     char           *laifn;
     char           *projectname;
@@ -34,6 +33,7 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
     char            scrn_char[100];
     time_t          rawtime;
     struct tm      *timeinfo;
+    double          value[7];
     int             NumForcing;
     int            *count;
     int             read_lai;
@@ -144,16 +144,18 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
     {
         fscanf (riv_file, "%s %d %d", DS->TSD_Riv[i].name, &DS->TSD_Riv[i].index, &DS->TSD_Riv[i].length);
 
-        DS->TSD_Riv[i].TS = (realtype **) malloc ((DS->TSD_Riv[i].length) * sizeof (realtype *));
-        for (j = 0; j < DS->TSD_Riv[i].length; j++)
-            DS->TSD_Riv[i].TS[j] = (realtype *) malloc (2 * sizeof (realtype));
+        AllocTS (&DS->TSD_Riv[i], 2);
+        DS->TSD_Riv[i].iCounter = 0;
 
         for (j = 0; j < DS->TSD_Riv[i].length; j++)
-            fscanf (riv_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &DS->TSD_Riv[i].TS[j][1]);
+        {
+            fscanf (riv_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &value[0]);
             timeinfo->tm_year = timeinfo->tm_year - 1900;
             timeinfo->tm_mon = timeinfo->tm_mon - 1;
             rawtime = timegm (timeinfo);
-            DS->TSD_Riv[i].TS[j][0] = (realtype) rawtime;
+            DS->TSD_Riv[i].Time[j] = (realtype) rawtime;
+            DS->TSD_Riv[i].TS[j][0] = value[0];
+        }
     }
 
     /* read in reservoir information */
@@ -433,10 +435,8 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
 
     for (i = 0; i < DS->NumTS; i++)
     {
-        DS->TSD_meteo[i].TS = (realtype **) malloc ((DS->TSD_meteo[i].length) * sizeof (realtype *));
+        AllocTS (&DS->TSD_meteo[i], NumForcing + 1);
         DS->TSD_meteo[i].iCounter = 0;
-        for (j = 0; j < DS->TSD_meteo[i].length; j++)
-            DS->TSD_meteo[i].TS[j] = (realtype *) malloc ((NumForcing + 1)* sizeof (realtype));
     }
 
     rewind(forc_file);
@@ -450,11 +450,13 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
 
         for (j = 0; j < DS->TSD_meteo[i].length; j++)
         {
-            fscanf (forc_file, "%d-%d-%d %d:%d:%d %lf %lf %lf %lf %lf %lf %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &DS->TSD_meteo[i].TS[j][1], &DS->TSD_meteo[i].TS[j][2], &DS->TSD_meteo[i].TS[j][3], &DS->TSD_meteo[i].TS[j][4], &DS->TSD_meteo[i].TS[j][5], &DS->TSD_meteo[i].TS[j][6], &DS->TSD_meteo[i].TS[j][7]);
+            fscanf (forc_file, "%d-%d-%d %d:%d:%d %lf %lf %lf %lf %lf %lf %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &value[0], &value[1], &value[2], &value[3], &value[4], &value[5], &value[6]);
             timeinfo->tm_year = timeinfo->tm_year - 1900;
             timeinfo->tm_mon = timeinfo->tm_mon - 1;
             rawtime = timegm (timeinfo);
-            DS->TSD_meteo[i].TS[j][0] = (realtype) rawtime;
+            DS->TSD_meteo[i].Time[j] = (realtype) rawtime;
+            for (k = 0; k < NumForcing; k++)
+                DS->TSD_meteo[i].TS[j][k] = value[k];
         }
     }
 
@@ -463,6 +465,7 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
         DS->windH[i] = DS->TSD_meteo[i].TSFactor;
 
     read_lai = 0;
+    DS->NumLAI = 0;
     read_ss = 0;
 
     for (i = 0; i < DS->NumEle; i++)
@@ -494,6 +497,7 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
         fscanf (lai_file, "%*s %d", &num_lai_ts);
 
         DS->TSD_lai = (TSD *) malloc (num_lai_ts * sizeof (TSD));
+        DS->NumLAI = num_lai_ts;
 
         rewind(lai_file);          /* For safety reasons, rewind and skip top line */
         fgets (cmdstr, MAXSTRING, lai_file);
@@ -532,9 +536,8 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
 
         for (i = 0; i < num_lai_ts; i++)
         {
-            DS->TSD_lai[i].TS = (realtype **) malloc ((DS->TSD_lai[i].length) * sizeof (realtype *));
-            for (j = 0; j < DS->TSD_lai[i].length; j++)
-                DS->TSD_lai[i].TS[j] = (realtype *) malloc (2 * sizeof (realtype));
+            AllocTS (&DS->TSD_lai[i], 2);
+            DS->TSD_lai[i].iCounter = 0;
         }
 
         rewind(lai_file);
@@ -548,11 +551,12 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
             fscanf (lai_file, "%*s %*s");
             for (j = 0; j < DS->TSD_lai[i].length; j++)
             {
-                fscanf (lai_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &DS->TSD_lai[i].TS[j][1]);
+                fscanf (lai_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &value[0]);
                 timeinfo->tm_year = timeinfo->tm_year - 1900;
                 timeinfo->tm_mon = timeinfo->tm_mon - 1;
                 rawtime = timegm (timeinfo);
-                DS->TSD_lai[i].TS[j][0] = (realtype) rawtime;
+                DS->TSD_lai[i].Time[j] = (realtype) rawtime;
+                DS->TSD_lai[i].TS[j][0] = value[0];
             }
         }
 
@@ -595,17 +599,17 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
         for (i = 0; i < DS->Num1BC; i++)
         {
             fscanf (ibc_file, "%s %d %d", DS->TSD_EleBC[i].name, &DS->TSD_EleBC[i].index, &DS->TSD_EleBC[i].length);
-            DS->TSD_EleBC[i].TS = (realtype **) malloc ((DS->TSD_EleBC[i].length) * sizeof (realtype *));
-            for (j = 0; j < DS->TSD_EleBC[i].length; j++)
-                DS->TSD_EleBC[i].TS[j] = (realtype *) malloc (2 * sizeof (realtype));
+            AllocTS (&DS->TSD_EleBC[i], 2);
+            DS->TSD_EleBC[i].iCounter = 0;
 
             for (j = 0; j < DS->TSD_EleBC[i].length; j++)
             {
-                fscanf (ibc_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &DS->TSD_EleBC[i].TS[j][1]);
+                fscanf (ibc_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &value[0]);
                 timeinfo->tm_year = timeinfo->tm_year - 1900;
                 timeinfo->tm_mon = timeinfo->tm_mon - 1;
                 rawtime = timegm (timeinfo);
-                DS->TSD_EleBC[i].TS[j][0] = (realtype) rawtime;
+                DS->TSD_EleBC[i].Time[j] = (realtype) rawtime;
+                DS->TSD_EleBC[i].TS[j][0] = value[0];
             }
         }
     }
@@ -619,17 +623,17 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
         {
             fscanf (ibc_file, "%s %d %d", DS->TSD_EleBC[i].name, &DS->TSD_EleBC[i].index, &DS->TSD_EleBC[i].length);
 
-            DS->TSD_EleBC[i].TS = (realtype **) malloc ((DS->TSD_EleBC[i].length) * sizeof (realtype *));
+            AllocTS (&DS->TSD_EleBC[i], 2);
+            DS->TSD_EleBC[i].iCounter = 0;
 
-            for (j = 0; j < DS->TSD_EleBC[i].length; j++)
-                DS->TSD_EleBC[i].TS[j] = (realtype *) malloc (2 * sizeof (realtype));
             for (j = 0; j < DS->TSD_EleBC[i].length; j++)
             {
-                fscanf (ibc_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &DS->TSD_EleBC[i].TS[j][1]);
+                fscanf (ibc_file, "%d-%d-%d %d:%d:%d %lf", &timeinfo->tm_year, &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour, &timeinfo->tm_min, &timeinfo->tm_sec, &value[0]);
                 timeinfo->tm_year = timeinfo->tm_year - 1900;
                 timeinfo->tm_mon = timeinfo->tm_mon - 1;
                 rawtime = timegm (timeinfo);
-                DS->TSD_EleBC[i].TS[j][0] = (realtype) rawtime;
+                DS->TSD_EleBC[i].Time[j] = (realtype) rawtime;
+                DS->TSD_EleBC[i].TS[j][0] = value[0];
             }
         }
     }
@@ -669,6 +673,14 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
     CS->GSType = 1;
     CS->MaxK = 0;
     CS->delt = 0;
+    CS->NumThreads = 0;
+    CS->VGTableTol = 0;
+    CS->RivTableTol = 0;
+    CS->RivTopoOrder = 0;
+    CS->EleOrder = 0;
+    CS->LeanMem = 0;
+    CS->FirstTouch = 0;
+    CS->ThreadVec = 0;
     CS->abstol = BADVAL;
     CS->reltol = BADVAL;
     CS->InitStep = BADVAL;
@@ -748,6 +760,22 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
                 sscanf (cmdstr, "%*s %d", &CS->MaxK);
             else if (strcasecmp ("DELTA", optstr) == 0)
                 sscanf (cmdstr, "%*s %lf", &CS->delt);
+            else if (strcasecmp ("NUM_THREADS", optstr) == 0)
+                sscanf (cmdstr, "%*s %d", &CS->NumThreads);
+            else if (strcasecmp ("VG_TABLE_TOL", optstr) == 0)
+                sscanf (cmdstr, "%*s %lf", &CS->VGTableTol);
+            else if (strcasecmp ("RIV_TABLE_TOL", optstr) == 0)
+                sscanf (cmdstr, "%*s %lf", &CS->RivTableTol);
+            else if (strcasecmp ("RIV_TOPO_ORDER", optstr) == 0)
+                sscanf (cmdstr, "%*s %d", &CS->RivTopoOrder);
+            else if (strcasecmp ("ELE_ORDER", optstr) == 0)
+                sscanf (cmdstr, "%*s %d", &CS->EleOrder);
+            else if (strcasecmp ("LEAN_MEMORY", optstr) == 0)
+                sscanf (cmdstr, "%*s %d", &CS->LeanMem);
+            else if (strcasecmp ("FIRST_TOUCH", optstr) == 0)
+                sscanf (cmdstr, "%*s %d", &CS->FirstTouch);
+            else if (strcasecmp ("THREAD_NVECTOR", optstr) == 0)
+                sscanf (cmdstr, "%*s %d", &CS->ThreadVec);
             else if (strcasecmp ("ABSTOL", optstr) == 0)
                 sscanf (cmdstr, "%*s %lf", &CS->abstol);
             else if (strcasecmp ("RELTOL", optstr) == 0)
@@ -838,30 +866,6 @@ void read_alloc (char *filename, Model_Data DS, Control_Data * CS)
 
     fclose (para_file);
 
-    if (CS->a != 1.0)
-        NumTout = (int)(log (1. - (CS->EndTime - CS->StartTime) * (1. - CS->a) / CS->b) / log (CS->a));
-    else
-    {
-        if ((CS->EndTime - CS->StartTime) / CS->b - ((int)(CS->EndTime - CS->StartTime) / CS->b) > 0)
-            NumTout = (int)((CS->EndTime - CS->StartTime) / CS->b);
-        else
-            NumTout = (int)((CS->EndTime - CS->StartTime) / CS->b - 1);
-    }
-
-    CS->NumSteps = NumTout + 1;
-
-    CS->Tout = (realtype *) malloc ((CS->NumSteps + 1) * sizeof (realtype));
-
-    for (i = 0; i < CS->NumSteps + 1; i++)
-    {
-        if (i == 0)
-            CS->Tout[i] = CS->StartTime;
-        else
-            CS->Tout[i] = CS->Tout[i - 1] + pow (CS->a, i) * CS->b;
-    }
-
-    if (CS->Tout[CS->NumSteps] < CS->EndTime)
-        CS->Tout[CS->NumSteps] = CS->EndTime;
     if (CS->abstol == BADVAL)
     {
         printf ("\n  Fatal Error: Absolute Tolerance (ABSTOL) must be defined in .para file!\n");
@@ -1101,15 +1105,15 @@ void FreeData (Model_Data DS, Control_Data * CS)
     /*
      * free river
      */
-    int             i, j, k;
+    int             i, j;
     for (i = 0; i < DS->NumRivBC; i++)
-    {
-        for (j = 0; j < DS->TSD_Riv[i].length; j++)
-            free (DS->TSD_Riv[i].TS[j]);
-        free (DS->TSD_Riv[i].TS);
-    }
+        FreeTS (&DS->TSD_Riv[i]);
 
+    for (i = 0; i < DS->NumRiv; i++)
+        free (DS->Riv[i].up);
     free (DS->Riv);
+    free (DS->RivLoc);
+    free (DS->EleLoc);
     free (DS->Riv_IC);
     free (DS->Riv_Shape);
     free (DS->Riv_Mat);
@@ -1127,6 +1131,12 @@ void FreeData (Model_Data DS, Control_Data * CS)
     /*
      * free soil
      */
+    for (i = 0; i < DS->NumSoil; i++)
+        FreeVGTable (&DS->VGTbl[i]);
+    free (DS->VGTbl);
+    for (i = 0; i < DS->NumRivShape; i++)
+        FreeRivTable (&DS->RivTbl[i]);
+    free (DS->RivTbl);
     free (DS->Soil);
     /*
      * free geol
@@ -1140,11 +1150,7 @@ void FreeData (Model_Data DS, Control_Data * CS)
      * free forc
      */
     for (j = 0; j < DS->NumTS; j++)
-    {
-        for (k = 0; k < DS->TSD_meteo[j].length; k++)
-            free (DS->TSD_meteo[j].TS[k]);
-        free (DS->TSD_meteo[j].TS);
-    }
+        FreeTS (&DS->TSD_meteo[j]);
     free (DS->TSD_meteo);
 
     free (DS->ISFactor);
@@ -1153,41 +1159,41 @@ void FreeData (Model_Data DS, Control_Data * CS)
      */
     if (DS->Num1BC > 0)
         for (i = 0; i < DS->Num1BC; i++)
-        {
-            for (j = 0; j < DS->TSD_EleBC[i].length; j++)
-                free (DS->TSD_EleBC[i].TS[j]);
-            free (DS->TSD_EleBC[i].TS);
-        }
+            FreeTS (&DS->TSD_EleBC[i]);
     if (DS->Num2BC > 0)
         for (i = DS->Num1BC; i < DS->Num1BC + DS->Num2BC; i++)
-        {
-            for (j = 0; j < DS->TSD_EleBC[i].length; j++)
-                free (DS->TSD_EleBC[i].TS[j]);
-            free (DS->TSD_EleBC[i].TS);
-        }
+            FreeTS (&DS->TSD_EleBC[i]);
 
 
     if (DS->Num1BC + DS->Num2BC > 0)
         free (DS->TSD_EleBC);
+    /*
+     * free lai
+     */
+    for (i = 0; i < DS->NumLAI; i++)
+        FreeTS (&DS->TSD_lai[i]);
+    if (DS->NumLAI > 0)
+        free (DS->TSD_lai);
     /*
      * free para
      */
-    free (CS->Tout);
     /*
      * free initialize.c
      */
-    for (i = 0; i < DS->NumEle; i++)
-        free (DS->FluxSurf[i]);
+    free (DS->FluxSurf[0]);
     free (DS->FluxSurf);
-    for (i = 0; i < DS->NumEle; i++)
-        free (DS->FluxSub[i]);
+    free (DS->FluxSub[0]);
     free (DS->FluxSub);
-    for (i = 0; i < DS->NumEle; i++)
-        free (DS->EleET[i]);
+    free (DS->EleET[0]);
     free (DS->EleET);
-    for (i = 0; i < DS->NumRiv; i++)
-        free (DS->FluxRiv[i]);
+    free (DS->FluxRiv[0]);
     free (DS->FluxRiv);
+    free (DS->JvFluxSurf[0]);
+    free (DS->JvFluxSurf);
+    free (DS->JvFluxSub[0]);
+    free (DS->JvFluxSub);
+    free (DS->JvFluxRiv[0]);
+    free (DS->JvFluxRiv);
     free (DS->EleNetPrep);
     free (DS->windH);
     free (DS->EleSurf);
@@ -1197,6 +1203,8 @@ void FreeData (Model_Data DS, Control_Data * CS)
     free (DS->ElePrep);
     free (DS->EleViR);
     free (DS->Recharge);
+    free (DS->JvEleViR);
+    free (DS->JvRecharge);
     free (DS->EleIS);
     free (DS->EleISmax);
     free (DS->EleISsnowmax);
@@ -1222,4 +1230,23 @@ void FreeData (Model_Data DS, Control_Data * CS)
      * free DummyY
      */
     free (DS->DummyY);
+    free (DS->EleEffKH);
+    free (DS->EleSlope);
+    free (DS->RivEffKH);
+    free (DS->EleArea);
+    free (DS->EleZmin);
+    free (DS->EleZmax);
+    free (DS->EleKsatH);
+    free (DS->EleKsatV);
+    free (DS->ElePorosity);
+    free (DS->EleAlpha);
+    free (DS->EleBeta);
+    free (DS->EleNabr);
+    free (DS->RivArea);
+    free (DS->RivPerem);
+    free (DS->IntrEdge);
+    free (DS->RivEdge);
+    free (DS->NoFlowEdge);
+    free (DS->DiriEdge);
+    free (DS->NeumEdge);
 }